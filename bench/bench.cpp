@@ -0,0 +1,357 @@
+// MBL runtime microbenchmarks -- build target `bench`.
+//
+// Each benchmark is a function that performs `iters` operations; the
+// harness calibrates the iteration count to a fixed wall-time budget and
+// reports ns/op.  On Linux, cycles/op and instructions/op come from perf
+// events when the kernel allows it (perf_event_paranoid permitting) and
+// are silently omitted when it does not.
+//
+// Baseline gating, for release sign-off:
+//
+//   mbl-bench --save baseline.json          # on the old runtime
+//   mbl-bench --baseline baseline.json      # on the new one
+//
+// The second run prints the delta per benchmark and exits non-zero when
+// any of them regresses by more than --threshold percent (default 3), so
+// "no regression > 3% on the amortize kernel" is a CI check, not a
+// judgement call.
+
+#include "arena.h"
+#include "bytecode.h"
+#include "datetime.h"
+#include "list.h"
+#include "money.h"
+#include "object.h"
+#include "output.h"
+#include "vm.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using mbl::Money;
+using mbl::Value;
+
+// --- perf-event counters (best effort) -----------------------------------
+
+struct PerfCounters {
+#if defined(__linux__)
+    int cyclesFd = -1;
+    int instructionsFd = -1;
+
+    static int openCounter(std::uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    PerfCounters() {
+        cyclesFd = openCounter(PERF_COUNT_HW_CPU_CYCLES);
+        instructionsFd = openCounter(PERF_COUNT_HW_INSTRUCTIONS);
+    }
+    ~PerfCounters() {
+        if (cyclesFd >= 0) close(cyclesFd);
+        if (instructionsFd >= 0) close(instructionsFd);
+    }
+    bool available() const { return cyclesFd >= 0 && instructionsFd >= 0; }
+    void start() {
+        if (!available()) return;
+        ioctl(cyclesFd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(instructionsFd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(cyclesFd, PERF_EVENT_IOC_ENABLE, 0);
+        ioctl(instructionsFd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    void stop(std::uint64_t& cycles, std::uint64_t& instructions) {
+        cycles = instructions = 0;
+        if (!available()) return;
+        ioctl(cyclesFd, PERF_EVENT_IOC_DISABLE, 0);
+        ioctl(instructionsFd, PERF_EVENT_IOC_DISABLE, 0);
+        (void)!read(cyclesFd, &cycles, sizeof(cycles));
+        (void)!read(instructionsFd, &instructions, sizeof(instructions));
+    }
+#else
+    bool available() const { return false; }
+    void start() {}
+    void stop(std::uint64_t& cycles, std::uint64_t& instructions) {
+        cycles = instructions = 0;
+    }
+#endif
+};
+
+// --- harness --------------------------------------------------------------
+
+using BenchFn = void (*)(std::size_t iters);
+
+struct Benchmark {
+    const char* name;
+    BenchFn fn;
+};
+
+std::vector<Benchmark>& registry() {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+struct Register {
+    Register(const char* name, BenchFn fn) { registry().push_back({name, fn}); }
+};
+
+#define MBL_BENCH(name)                                    \
+    void bench_##name(std::size_t iters);                  \
+    Register register_##name(#name, bench_##name);         \
+    void bench_##name(std::size_t iters)
+
+double nowSeconds() {
+    using Clock = std::chrono::steady_clock;
+    return std::chrono::duration<double>(Clock::now().time_since_epoch()).count();
+}
+
+struct Result {
+    double nsPerOp = 0;
+    double cyclesPerOp = 0;
+    double instructionsPerOp = 0;
+};
+
+Result measure(const Benchmark& b) {
+    // Calibrate: grow the iteration count until one run takes ~100ms.
+    std::size_t iters = 64;
+    double elapsed = 0;
+    for (;;) {
+        double start = nowSeconds();
+        b.fn(iters);
+        elapsed = nowSeconds() - start;
+        if (elapsed >= 0.1 || iters >= (std::size_t)1 << 30) break;
+        double scale = elapsed > 0 ? 0.12 / elapsed : 16.0;
+        if (scale > 16.0) scale = 16.0;
+        iters = (std::size_t)((double)iters * scale) + 1;
+    }
+
+    // Measured run, with counters.
+    PerfCounters counters;
+    counters.start();
+    double start = nowSeconds();
+    b.fn(iters);
+    elapsed = nowSeconds() - start;
+    std::uint64_t cycles, instructions;
+    counters.stop(cycles, instructions);
+
+    Result r;
+    r.nsPerOp = elapsed * 1e9 / (double)iters;
+    if (counters.available()) {
+        r.cyclesPerOp = (double)cycles / (double)iters;
+        r.instructionsPerOp = (double)instructions / (double)iters;
+    }
+    return r;
+}
+
+// --- JSON baseline (flat {"name": ns, ...}, written and read here) --------
+
+void saveBaseline(const std::string& path, const std::map<std::string, double>& results) {
+    std::ofstream out(path);
+    out << "{\n";
+    bool first = true;
+    for (const auto& entry : results) {
+        if (!first) out << ",\n";
+        first = false;
+        out << "  \"" << entry.first << "\": " << entry.second;
+    }
+    out << "\n}\n";
+}
+
+std::map<std::string, double> loadBaseline(const std::string& path) {
+    std::map<std::string, double> baseline;
+    std::ifstream in(path);
+    if (!in) {
+        std::fprintf(stderr, "Cannot read baseline %s\n", path.c_str());
+        std::exit(2);
+    }
+    std::stringstream buf;
+    buf << in.rdbuf();
+    std::string text = buf.str();
+    std::size_t pos = 0;
+    while ((pos = text.find('"', pos)) != std::string::npos) {
+        std::size_t end = text.find('"', pos + 1);
+        if (end == std::string::npos) break;
+        std::string name = text.substr(pos + 1, end - pos - 1);
+        std::size_t colon = text.find(':', end);
+        if (colon == std::string::npos) break;
+        baseline[name] = std::strtod(text.c_str() + colon + 1, nullptr);
+        pos = text.find(',', colon);
+        if (pos == std::string::npos) break;
+    }
+    return baseline;
+}
+
+// --- benchmarks -----------------------------------------------------------
+
+// Money arithmetic over a ledger-sized column; one op = one element.
+MBL_BENCH(money_batch_add) {
+    static std::vector<Money> a(65536, Money::fromMajor(1234)),
+                              b(65536, Money::fromMajor(7)),
+                              out(65536);
+    std::size_t rounds = iters / a.size() + 1;
+    for (std::size_t r = 0; r < rounds; ++r)
+        mbl::batchAdd(out.data(), a.data(), b.data(), a.size());
+}
+
+MBL_BENCH(money_mul_ratio) {
+    Money m = Money::fromString("1234.56");
+    Money sink = Money();
+    for (std::size_t i = 0; i < iters; ++i) sink = sink + m.mulRatio(525, 10000);
+    if (sink.units == 42) std::puts("");  // keep the loop live
+}
+
+// T-literal date math: the parse happens once at compile time; the loop
+// is what runtime pays per `paymentDate += T"1 month"`.
+MBL_BENCH(date_add_interval) {
+    mbl::Interval month = mbl::parseTimeLiteral("1 month", mbl::dateTimeNow()).span;
+    mbl::DateTime d = mbl::DateTime::make(2026, 1, 31);
+    for (std::size_t i = 0; i < iters; ++i) d = mbl::addInterval(d, month);
+    if (d.year() == 0) std::puts("");
+}
+
+MBL_BENCH(list_append) {
+    static mbl::Arena arena;
+    mbl::ArenaScope scope(arena);
+    mbl::List* list = mbl::List::create();
+    for (std::size_t i = 0; i < iters; ++i) list->append(Value::ofInt((std::int64_t)i));
+}
+
+// Property access through a prototype chain, via the inline cache the VM
+// uses -- the steady-state cost of `period.principalBalance`.
+MBL_BENCH(prop_access_proto) {
+    static mbl::Object* proto = [] {
+        mbl::Object* p = new mbl::Object();
+        p->set("interestRate", Value::ofInt(525));
+        return p;
+    }();
+    static mbl::Object* obj = [] {
+        mbl::Object* o = new mbl::Object();
+        o->setProto(proto);
+        o->set("balance", Value::ofMoney(Money::fromMajor(250000)));
+        return o;
+    }();
+    static mbl::PropAccess site{mbl::intern("interestRate"), {}, {}};
+    std::int64_t sink = 0;
+    for (std::size_t i = 0; i < iters; ++i) sink += mbl::getPropCached(obj, site).integer;
+    if (sink == 42) std::puts("");
+}
+
+// `new <template>` cloning, arena-hosted as loop-local objects are.  The
+// template lives in the same arena scope as its clones: cloning freezes
+// the template's slots into a snapshot holder, so template and clones
+// must share a lifetime.
+MBL_BENCH(new_clone) {
+    static mbl::Arena arena;
+    mbl::ArenaScope scope(arena);
+    mbl::Object* templ = mbl::Object::create();
+    templ->set("principal", Value::ofMoney(Money::fromMajor(1000)));
+    templ->set("rate", Value::ofInt(500));
+    templ->set("term", Value::ofInt(360));
+    for (std::size_t i = 0; i < iters; ++i) (void)mbl::cloneCow(templ);
+}
+
+MBL_BENCH(output_sink) {
+    static mbl::OutputSink* sink = [] {
+        int fd = ::open("/dev/null", O_WRONLY);
+        return new mbl::OutputSink(fd);
+    }();
+    for (std::size_t i = 0; i < iters; ++i) sink->writeLine("period 123 interest 512.50");
+    sink->flush();
+}
+
+// The amortize kernel: a While loop deducting payments from a Money
+// balance -- the shape of workload the tiered interpreter exists for.
+MBL_BENCH(amortize_kernel) {
+    using namespace mbl;
+    Chunk c;
+    auto kBalance = c.addConstant(Value::ofMoney(Money::fromMajor(250000)));
+    auto kPayment = c.addConstant(Value::ofMoney(Money::fromString("1613.09")));
+    auto kZero = c.addConstant(Value::ofMoney(Money()));
+    c.registerCount = 4;
+    c.emit(encodeABx(Op::LoadConst, 0, kBalance));
+    c.emit(encodeABx(Op::LoadConst, 1, kPayment));
+    c.emit(encodeABx(Op::LoadConst, 2, kZero));
+    std::size_t top = c.code.size();
+    c.emit(encodeABC(Op::Lt, 3, 2, 0));
+    std::size_t exit = c.emit(encodeABx(Op::JumpIfFalse, 3, 0));
+    c.emit(encodeABC(Op::Sub, 0, 0, 1));
+    std::size_t back = c.emit(encodeABx(Op::Jump, 0, 0));
+    c.code[back] = encodeABx(Op::Jump, 0,
+                             (std::uint16_t)(std::int16_t)((int)top - (int)back - 1));
+    c.patchJumpToHere(exit);
+    c.emit(encodeABC(Op::Return, 0, 0, 0));
+
+    VM vm;
+    // One "op" is one loop iteration; the balance supports ~155 of them.
+    std::size_t runs = iters / 155 + 1;
+    for (std::size_t r = 0; r < runs; ++r) (void)vm.run(c);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string savePath, baselinePath;
+    double threshold = 3.0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--save" && i + 1 < argc) savePath = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc) baselinePath = argv[++i];
+        else if (arg == "--threshold" && i + 1 < argc) threshold = std::strtod(argv[++i], nullptr);
+        else {
+            std::fprintf(stderr,
+                         "usage: mbl-bench [--save out.json] [--baseline in.json]"
+                         " [--threshold pct]\n");
+            return 2;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baselinePath.empty()) baseline = loadBaseline(baselinePath);
+
+    std::map<std::string, double> results;
+    bool regressed = false;
+    for (const Benchmark& b : registry()) {
+        Result r = measure(b);
+        results[b.name] = r.nsPerOp;
+        std::printf("%-20s %10.2f ns/op", b.name, r.nsPerOp);
+        if (r.cyclesPerOp > 0) {
+            std::printf("  %8.1f cyc/op  %8.1f ins/op", r.cyclesPerOp, r.instructionsPerOp);
+        }
+        auto it = baseline.find(b.name);
+        if (it != baseline.end() && it->second > 0) {
+            double deltaPct = (r.nsPerOp - it->second) / it->second * 100.0;
+            std::printf("  %+6.1f%%", deltaPct);
+            if (deltaPct > threshold) {
+                std::printf("  REGRESSION");
+                regressed = true;
+            }
+        }
+        std::printf("\n");
+    }
+
+    if (!savePath.empty()) saveBaseline(savePath, results);
+    return regressed ? 1 : 0;
+}
@@ -0,0 +1,194 @@
+#include "aggregate.h"
+
+#include "error.h"
+#include "money.h"
+#include "scheduler.h"
+
+#include <vector>
+
+namespace mbl {
+
+namespace {
+
+// Elements per parallel range: large enough that a range amortizes its
+// scheduling, small enough that steals rebalance a skewed tail.
+constexpr std::size_t kGrain = 64 * 1024;
+
+[[noreturn]] void mixedTypes(const char* op) {
+    throw MblError(std::string("Cannot ") + op + " values of mixed types");
+}
+
+// Fold one element into an accumulator; Missing accumulator adopts the
+// element's type, Missing elements are skipped by the callers.
+void foldSum(Value& acc, Value v) {
+    if (acc.isMissing()) { acc = v; return; }
+    if (acc.tag == Tag::MoneyVal && v.tag == Tag::MoneyVal) {
+        acc.money = acc.money + v.money;
+    } else if (acc.tag == Tag::Integer && v.tag == Tag::Integer) {
+        acc.integer += v.integer;
+    } else if (acc.tag == Tag::Float && v.tag == Tag::Float) {
+        acc.real += v.real;
+    } else if (acc.tag == Tag::Integer && v.tag == Tag::Float) {
+        acc = Value::ofFloat((double)acc.integer + v.real);
+    } else if (acc.tag == Tag::Float && v.tag == Tag::Integer) {
+        acc.real += (double)v.integer;
+    } else {
+        mixedTypes("Sum");
+    }
+}
+
+bool orderedLess(Value a, Value b) {
+    if (a.tag == Tag::Integer && b.tag == Tag::Integer) return a.integer < b.integer;
+    if (a.tag == Tag::MoneyVal && b.tag == Tag::MoneyVal) return a.money < b.money;
+    if (a.tag == Tag::Float && b.tag == Tag::Float) return a.real < b.real;
+    if (a.tag == Tag::Date && b.tag == Tag::Date) return a.date < b.date;
+    mixedTypes("order");
+}
+
+void foldMin(Value& acc, Value v) {
+    if (acc.isMissing() || orderedLess(v, acc)) acc = v;
+}
+
+void foldMax(Value& acc, Value v) {
+    if (acc.isMissing() || orderedLess(acc, v)) acc = v;
+}
+
+// The tree reduction: workers fold grain-sized ranges into partials, the
+// partials combine in index order on the calling thread.
+template <typename FoldRange>
+Value reduceRanges(std::size_t n, const FoldRange& foldRange,
+                   void (*combine)(Value&, Value)) {
+    if (n == 0) return Value::missing();
+    std::size_t ranges = (n + kGrain - 1) / kGrain;
+    std::vector<Value> partials(ranges);
+    Scheduler::global().parallelFor(n, kGrain, [&](std::size_t begin, std::size_t end) {
+        partials[begin / kGrain] = foldRange(begin, end);
+    });
+    Value total = Value::missing();
+    for (Value& p : partials) {
+        if (!p.isMissing()) combine(total, p);
+    }
+    return total;
+}
+
+Value reduceList(const List& values, void (*fold)(Value&, Value)) {
+    return reduceRanges(
+        values.size(),
+        [&](std::size_t begin, std::size_t end) {
+            Value acc = Value::missing();
+            for (std::size_t i = begin; i < end; ++i) {
+                Value v = values.at(i);
+                if (!v.isMissing()) fold(acc, v);
+            }
+            return acc;
+        },
+        fold);
+}
+
+} // namespace
+
+Value sumList(const List& values) { return reduceList(values, foldSum); }
+Value minList(const List& values) { return reduceList(values, foldMin); }
+Value maxList(const List& values) { return reduceList(values, foldMax); }
+
+Value sumTableColumn(const Table& table, std::size_t col) {
+    if (col >= table.columnCount()) throw MblError("Table column out of range");
+    std::size_t rows = table.rowCount();
+    switch (table.columnType(col)) {
+        case Tag::MoneyVal: {
+            // Per-range batchSum keeps the checked two-accumulator kernel
+            // on the inner loop; partials add exactly, so worker count
+            // never changes the answer.
+            const Money* data = table.moneyData(col);
+            return reduceRanges(
+                rows,
+                [&](std::size_t begin, std::size_t end) {
+                    return Value::ofMoney(batchSum(data + begin, end - begin));
+                },
+                foldSum);
+        }
+        case Tag::Integer: {
+            const std::int64_t* data = table.intData(col);
+            return reduceRanges(
+                rows,
+                [&](std::size_t begin, std::size_t end) {
+                    std::int64_t total = 0;
+                    for (std::size_t i = begin; i < end; ++i) total += data[i];
+                    return Value::ofInt(total);
+                },
+                foldSum);
+        }
+        case Tag::Float: {
+            const double* data = table.floatData(col);
+            return reduceRanges(
+                rows,
+                [&](std::size_t begin, std::size_t end) {
+                    double total = 0;
+                    for (std::size_t i = begin; i < end; ++i) total += data[i];
+                    return Value::ofFloat(total);
+                },
+                foldSum);
+        }
+        default:
+            throw MblError("Cannot sum a Date column");
+    }
+}
+
+namespace {
+
+Value tableExtreme(const Table& table, std::size_t col, void (*fold)(Value&, Value)) {
+    if (col >= table.columnCount()) throw MblError("Table column out of range");
+    std::size_t rows = table.rowCount();
+    return reduceRanges(
+        rows,
+        [&](std::size_t begin, std::size_t end) {
+            Value acc = Value::missing();
+            for (std::size_t i = begin; i < end; ++i) fold(acc, table.at(i, col));
+            return acc;
+        },
+        fold);
+}
+
+} // namespace
+
+Value minTableColumn(const Table& table, std::size_t col) {
+    return tableExtreme(table, col, foldMin);
+}
+
+Value maxTableColumn(const Table& table, std::size_t col) {
+    return tableExtreme(table, col, foldMax);
+}
+
+GroupSums groupBySum(const Table& table, std::size_t keyCol, std::size_t valueCol) {
+    if (keyCol >= table.columnCount() || valueCol >= table.columnCount())
+        throw MblError("Table column out of range");
+    Tag keyType = table.columnType(keyCol);
+    if (keyType != Tag::Integer && keyType != Tag::Date)
+        throw MblError("GroupBy keys must be an Integer or Date column");
+
+    std::size_t rows = table.rowCount();
+    std::size_t ranges = (rows + kGrain - 1) / kGrain;
+    std::vector<GroupSums> partials(ranges == 0 ? 1 : ranges);
+
+    Scheduler::global().parallelFor(rows, kGrain, [&](std::size_t begin, std::size_t end) {
+        GroupSums& local = partials[begin / kGrain];
+        for (std::size_t i = begin; i < end; ++i) {
+            GroupKey key;
+            key.tag = keyType;
+            key.bits = keyType == Tag::Integer
+                           ? (std::uint64_t)table.intData(keyCol)[i]
+                           : table.dateData(keyCol)[i].packed;
+            foldSum(local[key], table.at(i, valueCol));
+        }
+    });
+
+    // Merge in range order so every group's sum sees its addends in row
+    // order -- exact for Money, deterministic for Float.
+    GroupSums result;
+    for (GroupSums& local : partials) {
+        for (auto& entry : local) foldSum(result[entry.first], entry.second);
+    }
+    return result;
+}
+
+} // namespace mbl
@@ -0,0 +1,65 @@
+#ifndef MBL_AGGREGATE_H
+#define MBL_AGGREGATE_H
+
+#include <cstddef>
+#include <unordered_map>
+
+#include "list.h"
+#include "table.h"
+#include "value.h"
+
+namespace mbl {
+
+// The built-in folds business code reaches for instead of a scalar While
+// loop: Sum, Min, Max and GroupBy over lists and table columns.  Each
+// runs as a tree reduction on the Scheduler -- workers fold disjoint
+// chunk ranges into partials, and the partials combine in index order.
+//
+// Combining in index order matters for Money: addition of exact
+// fixed-point values is associative, so the parallel sum equals the
+// sequential sum bit for bit, and overflow is detected wherever it
+// happens.  Float sums are combined in the same fixed order so a given
+// collection always produces the same answer regardless of worker count
+// or timing -- deterministic, though (being floating point) not equal to
+// every other summation order.
+//
+// Sum/Min/Max over a Missing-free Money/Integer/Float column or list
+// return that type; Missing elements in lists are skipped, matching
+// MBL's "absent, not zero" reading.  Empty input sums to Missing.
+
+Value sumList(const List& values);
+Value minList(const List& values);
+Value maxList(const List& values);
+
+Value sumTableColumn(const Table& table, std::size_t col);
+Value minTableColumn(const Table& table, std::size_t col);
+Value maxTableColumn(const Table& table, std::size_t col);
+
+// GroupBy: folds `value` per distinct `key`.  Keys are Integer or Date
+// columns (the types a Table can hold that identify rather than
+// measure); values follow the Sum rules above.  Parallel workers build
+// per-range maps that merge in range order, keeping Money exactness and
+// Float determinism.
+struct GroupKey {
+    Tag tag;
+    std::uint64_t bits;  // integer value or packed date
+
+    bool operator==(const GroupKey& o) const {
+        return tag == o.tag && bits == o.bits;
+    }
+};
+
+struct GroupKeyHash {
+    std::size_t operator()(const GroupKey& k) const {
+        return (std::size_t)k.bits * 0x9E3779B97F4A7C15ull;
+    }
+};
+
+using GroupSums = std::unordered_map<GroupKey, Value, GroupKeyHash>;
+
+// Groups rows of `table` by `keyCol`, summing `valueCol` per group.
+GroupSums groupBySum(const Table& table, std::size_t keyCol, std::size_t valueCol);
+
+} // namespace mbl
+
+#endif
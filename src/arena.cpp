@@ -0,0 +1,112 @@
+#include "arena.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace mbl {
+
+struct Arena::Block {
+    Block* prev;
+    std::size_t size;   // capacity of data[]
+    std::size_t used;
+    alignas(std::max_align_t) char data[1];
+};
+
+namespace {
+thread_local Arena* tlsArena = nullptr;
+
+inline std::size_t alignUp(std::size_t n, std::size_t align) {
+    return (n + align - 1) & ~(align - 1);
+}
+} // namespace
+
+Arena* currentArena() { return tlsArena; }
+
+Arena::Arena(std::size_t firstBlockSize) : current_(nullptr), nextBlockSize_(firstBlockSize) {
+    current_ = grow(0);
+}
+
+Arena::~Arena() {
+    auto freeChain = [](Block* b) {
+        while (b) {
+            Block* prev = b->prev;
+            std::free(b);
+            b = prev;
+        }
+    };
+    freeChain(current_);
+    freeChain(spare_);
+}
+
+Arena::Block* Arena::grow(std::size_t need) {
+    // Reuse a rewound block if one is big enough, otherwise malloc the next
+    // size up (doubling, but never smaller than the request).
+    Block** link = &spare_;
+    while (*link) {
+        if ((*link)->size >= need) {
+            Block* b = *link;
+            *link = b->prev;
+            b->prev = nullptr;
+            b->used = 0;
+            return b;
+        }
+        link = &(*link)->prev;
+    }
+    std::size_t size = nextBlockSize_;
+    while (size < need) size *= 2;
+    nextBlockSize_ = size * 2;
+    Block* b = (Block*)std::malloc(sizeof(Block) + size);
+    if (!b) throw std::bad_alloc();
+    b->prev = nullptr;
+    b->size = size;
+    b->used = 0;
+    return b;
+}
+
+void* Arena::alloc(std::size_t bytes, std::size_t align) {
+    bytes = alignUp(bytes, align);
+    // Align the absolute address, not the offset: data[] is only
+    // max_align_t-aligned, so an offset-aligned pointer would miss stricter
+    // requests (the cache-line-aligned list chunks).
+    std::uintptr_t base = (std::uintptr_t)current_->data;
+    std::size_t at = alignUp(base + current_->used, align) - base;
+    if (at + bytes > current_->size) {
+        Block* b = grow(bytes + align - 1);
+        b->prev = current_;
+        current_ = b;
+        base = (std::uintptr_t)current_->data;
+        at = alignUp(base, align) - base;
+    }
+    // bytesUsed_ tracks block->used exactly (padding included) so release()
+    // can rewind the count by block arithmetic alone.
+    bytesUsed_ += at + bytes - current_->used;
+    current_->used = at + bytes;
+    return current_->data + at;
+}
+
+Arena::Marker Arena::mark() const { return Marker{current_, current_->used}; }
+
+void Arena::release(Marker m) {
+    while (current_ != m.block) {
+        Block* prev = current_->prev;
+        bytesUsed_ -= current_->used;
+        current_->prev = spare_;
+        spare_ = current_;
+        current_ = prev;
+    }
+    bytesUsed_ -= current_->used - m.used;
+    current_->used = m.used;
+}
+
+ArenaScope::ArenaScope(Arena& arena)
+    : arena_(arena), mark_(arena.mark()), previous_(tlsArena) {
+    tlsArena = &arena_;
+}
+
+ArenaScope::~ArenaScope() {
+    arena_.release(mark_);
+    tlsArena = previous_;
+}
+
+} // namespace mbl
@@ -0,0 +1,85 @@
+#ifndef MBL_ARENA_H
+#define MBL_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+namespace mbl {
+
+// Region allocator for per-invocation object graphs.  A Tool invocation or
+// web-service request opens an ArenaScope; every object (and its slot
+// array) born while the scope is active is bump-allocated from the arena,
+// and the scope's destructor releases all of it by rewinding one pointer.
+// Nothing inside an arena is individually freed or destructed, so only
+// trivially destructible runtime structures may live there -- Value and the
+// object slot arrays qualify by construction.
+//
+// Blocks are malloc'd in growing powers of two and kept on a free chain
+// after a rewind, so a server that opens an arena per request stops
+// touching malloc entirely once the first few requests have sized it.
+class Arena {
+public:
+    explicit Arena(std::size_t firstBlockSize = 64 * 1024);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* alloc(std::size_t bytes, std::size_t align = alignof(std::max_align_t));
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value ||
+                          !std::is_destructible<T>::value,
+                      "arena objects are never destructed");
+        return new (alloc(sizeof(T), alignof(T))) T(static_cast<Args&&>(args)...);
+    }
+
+    // A position in the arena; release() rewinds to it, recycling every
+    // block allocated after the mark.
+    struct Block;
+    struct Marker {
+        Block* block;
+        std::size_t used;
+    };
+    Marker mark() const;
+    void release(Marker m);
+
+    // Total bytes currently handed out (for the profiling surface).
+    std::size_t bytesUsed() const { return bytesUsed_; }
+
+private:
+    Block* grow(std::size_t need);
+
+    Block* current_;
+    Block* spare_ = nullptr;        // rewound blocks kept for reuse
+    std::size_t nextBlockSize_;
+    std::size_t bytesUsed_ = 0;
+};
+
+// The arena new objects are currently born into, or null for plain heap
+// allocation.  Thread-local: parallel Tool invocations each get their own.
+Arena* currentArena();
+
+// RAII invocation scope: installs `arena` as the current arena and rewinds
+// it to the entry mark on destruction.  Scopes nest; an inner Tool call can
+// stack a scope on the same arena and only its own garbage is released.
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena& arena);
+    ~ArenaScope();
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    Arena& arena_;
+    Arena::Marker mark_;
+    Arena* previous_;
+};
+
+} // namespace mbl
+
+#endif
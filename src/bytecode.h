@@ -0,0 +1,154 @@
+#ifndef MBL_BYTECODE_H
+#define MBL_BYTECODE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "object.h"
+#include "profile.h"
+#include "value.h"
+
+namespace mbl {
+
+// The compiled form of an MBL function: register-based bytecode, in the
+// Lua/LuaJIT family rather than a stack machine, because a register design
+// turns `period.principalBalance >= payment` into one compare instead of a
+// push/push/compare/pop dance.
+//
+// Instructions are a fixed 32 bits: 8-bit opcode and either three 8-bit
+// register operands (A, B, C) or one register plus a 16-bit immediate (A,
+// Bx) for constant indexes and jump offsets.  Jump offsets are signed and
+// relative to the following instruction.
+
+enum class Op : std::uint8_t {
+    LoadConst,   // A = constants[Bx]
+    LoadMissing, // A = Missing
+    Move,        // A = B
+
+    Add,         // A = B + C   (numeric or Money)
+    Sub,         // A = B - C
+    Mul,         // A = B * C   (Money * integer scales exactly)
+    Div,         // A = B / C
+    Neg,         // A = -B
+    PercentOf,   // A = B% Of C: C scaled by B/100 with ONE rounding, not a
+                 // Mul temporary rounded and divided again
+    MulRatio,    // A = B * C / C+1 (num/den in a register pair), one rounding
+                 // at the end.  The compiler emits this for a proven chain
+                 // like `rate% Of amount / perYear` -- the /100 of percent
+                 // and the /perYear fold into one denominator, so the whole
+                 // expression rounds exactly once.  Register allocation
+                 // already places operand temps consecutively, which is what
+                 // the pair convention relies on.
+
+    Eq,          // A = B == C
+    Lt,          // A = B < C
+    Le,          // A = B <= C
+    Not,         // A = not truthy(B)
+
+    Jump,        // pc += sBx
+    JumpIfFalse, // if not truthy(A): pc += sBx
+    JumpIfTrue,  // if truthy(A): pc += sBx
+
+    NewObject,   // A = new empty object; if truthy(reg B), proto = reg B
+    GetProp,     // A = reg[B].<props[C].name>, through the inline cache
+    SetProp,     // reg[A].<props[C].name> = reg[B], through the inline cache
+    NewFrom,     // A = copy-on-write clone of object in B (`new <object>`)
+
+    NewList,     // A = new empty list; reg B (if Integer) is a capacity hint
+    Append,      // Append reg[B] To reg[A]
+    GetIndex,    // A = reg[B][reg[C]]  (zero-based Integer index)
+    Length,      // A = element count of reg[B] (list)
+
+    PushScope,   // open a lexical frame with Bx slots (see resolve.h)
+    PopScope,    // close the innermost frame
+    GetScoped,   // A = frame-at-depth-B.slots[C]
+    SetScoped,   // frame-at-depth-B.slots[C] = reg[A]
+
+    Return,      // return register A
+    Halt,        // stop with Missing (end of top-level code)
+
+    // Type-specialized forms installed by loop tier-up (see jit.h).  Each
+    // guards its operand tags and deoptimizes the site back to the generic
+    // opcode above on mismatch; the compiler never emits these directly.
+    AddInt, SubInt, MulInt,
+    AddMoney, SubMoney,
+    LtInt, LeInt,
+    LtMoney, LeMoney,
+    PercentOfMoney,  // integer rate, Money value -- the interest shape
+};
+
+using Instruction = std::uint32_t;
+
+inline Instruction encodeABC(Op op, std::uint8_t a, std::uint8_t b, std::uint8_t c) {
+    return (std::uint32_t)op | ((std::uint32_t)a << 8) |
+           ((std::uint32_t)b << 16) | ((std::uint32_t)c << 24);
+}
+
+inline Instruction encodeABx(Op op, std::uint8_t a, std::uint16_t bx) {
+    return (std::uint32_t)op | ((std::uint32_t)a << 8) | ((std::uint32_t)bx << 16);
+}
+
+inline Op opcode(Instruction i) { return (Op)(i & 0xFF); }
+inline std::uint8_t operandA(Instruction i) { return (i >> 8) & 0xFF; }
+inline std::uint8_t operandB(Instruction i) { return (i >> 16) & 0xFF; }
+inline std::uint8_t operandC(Instruction i) { return (i >> 24) & 0xFF; }
+inline std::uint16_t operandBx(Instruction i) { return (i >> 16) & 0xFFFF; }
+inline std::int16_t operandSBx(Instruction i) { return (std::int16_t)((i >> 16) & 0xFFFF); }
+
+// One compiled function plus everything the VM needs to run it.
+struct Chunk {
+    std::vector<Instruction> code;
+    std::vector<Value> constants;
+    // Property-access sites (name + inline cache), indexed by the C operand
+    // of GetProp/SetProp.  255 distinct sites per chunk is generous for one
+    // compiled function; the compiler splits chunks long before that.
+    std::vector<PropAccess> props;
+    // Per-instruction hotness counters for backward jumps, sized on first
+    // run; drives loop tier-up (jit.h).
+    std::vector<std::uint16_t> hotCounts;
+    // Profiling attribution (profile.h): the compiler points profileSite at
+    // this Function's registered site, and marks any loop it wants reported
+    // separately on the loop's backward jump.  Both default to "not
+    // profiled" and cost nothing when left that way.
+    std::uint32_t profileSite = kNoProfileSite;
+    std::vector<std::uint32_t> loopSites;
+    int registerCount = 0;
+
+    std::uint16_t addConstant(Value v) {
+        constants.push_back(v);
+        return (std::uint16_t)(constants.size() - 1);
+    }
+
+    std::uint8_t addPropSite(const std::string& name) {
+        props.push_back(PropAccess{intern(name), PropCache{}, {}});
+        return (std::uint8_t)(props.size() - 1);
+    }
+
+    // Set-site variant carrying compiled constraint guards.
+    std::uint8_t addPropSite(const std::string& name, std::vector<Guard> guards) {
+        props.push_back(PropAccess{intern(name), PropCache{}, std::move(guards)});
+        return (std::uint8_t)(props.size() - 1);
+    }
+
+    // Attributes the backward jump at `jumpAt` to a registered loop site.
+    void markLoopSite(std::size_t jumpAt, std::uint32_t site) {
+        if (loopSites.size() < code.size()) loopSites.resize(code.size(), kNoProfileSite);
+        loopSites[jumpAt] = site;
+    }
+
+    std::size_t emit(Instruction i) {
+        code.push_back(i);
+        return code.size() - 1;
+    }
+
+    // Back-patches the jump at `at` to land on the next emitted instruction.
+    void patchJumpToHere(std::size_t at) {
+        std::int32_t offset = (std::int32_t)code.size() - (std::int32_t)at - 1;
+        code[at] = encodeABx(opcode(code[at]), operandA(code[at]),
+                             (std::uint16_t)(std::int16_t)offset);
+    }
+};
+
+} // namespace mbl
+
+#endif
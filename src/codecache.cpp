@@ -0,0 +1,257 @@
+#include "codecache.h"
+
+#include "error.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mbl {
+
+namespace {
+
+constexpr std::uint32_t kMagic = 0x4D424C43;  // "MBLC"
+constexpr std::uint32_t kVersion = 1;
+
+// Constant encoding tags, numbered independently of Tag like the other
+// on-disk formats.
+enum : std::uint8_t {
+    kMissing, kBool, kInt, kFloat, kMoney, kDate, kInterval, kText
+};
+
+std::uint64_t fnv1a(std::uint64_t h, const void* data, std::size_t n) {
+    const std::uint8_t* p = (const std::uint8_t*)data;
+    for (std::size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
+
+struct Writer {
+    std::FILE* out;
+
+    void bytes(const void* p, std::size_t n) {
+        if (std::fwrite(p, 1, n, out) != n) throw MblError("Code cache write failed");
+    }
+    void u8(std::uint8_t v) { bytes(&v, 1); }
+    void u32(std::uint32_t v) { bytes(&v, 4); }
+    void u64(std::uint64_t v) { bytes(&v, 8); }
+    void i64(std::int64_t v) { bytes(&v, 8); }
+    void name(Symbol s) {
+        const std::string& text = symbolName(s);
+        u32((std::uint32_t)text.size());
+        bytes(text.data(), text.size());
+    }
+};
+
+struct Reader {
+    const char* p;
+    const char* end;
+
+    bool need(std::size_t n) const { return (std::size_t)(end - p) >= n; }
+    bool bytes(void* out, std::size_t n) {
+        if (!need(n)) return false;
+        std::memcpy(out, p, n);
+        p += n;
+        return true;
+    }
+    bool u8(std::uint8_t& v) { return bytes(&v, 1); }
+    bool u32(std::uint32_t& v) { return bytes(&v, 4); }
+    bool u64(std::uint64_t& v) { return bytes(&v, 8); }
+    bool i64(std::int64_t& v) { return bytes(&v, 8); }
+    bool name(Symbol& s) {
+        std::uint32_t len;
+        if (!u32(len) || !need(len)) return false;
+        s = intern(std::string(p, len));
+        p += len;
+        return true;
+    }
+};
+
+bool cacheableConstant(Value v) {
+    return v.tag != Tag::Obj && v.tag != Tag::ListVal;
+}
+
+void writeConstant(Writer& w, Value v) {
+    switch (v.tag) {
+        case Tag::Missing: w.u8(kMissing); return;
+        case Tag::Boolean: w.u8(kBool); w.u8(v.boolean ? 1 : 0); return;
+        case Tag::Integer: w.u8(kInt); w.i64(v.integer); return;
+        case Tag::Float: w.u8(kFloat); w.bytes(&v.real, 8); return;
+        case Tag::MoneyVal: w.u8(kMoney); w.bytes(&v.money.units, 16); return;
+        case Tag::Date: w.u8(kDate); w.u64(v.date.packed); return;
+        case Tag::IntervalVal: w.u8(kInterval); w.u64(v.interval); return;
+        case Tag::Text:
+            w.u8(kText);
+            w.u32((std::uint32_t)v.text->size());
+            w.bytes(v.text->data(), v.text->size());
+            return;
+        default: throw MblError("Constant cannot be cached");
+    }
+}
+
+bool readConstant(Reader& r, Value& out) {
+    std::uint8_t tag;
+    if (!r.u8(tag)) return false;
+    switch (tag) {
+        case kMissing: out = Value::missing(); return true;
+        case kBool: { std::uint8_t b; if (!r.u8(b)) return false; out = Value::ofBool(b != 0); return true; }
+        case kInt: { std::int64_t v; if (!r.i64(v)) return false; out = Value::ofInt(v); return true; }
+        case kFloat: { double d; if (!r.bytes(&d, 8)) return false; out = Value::ofFloat(d); return true; }
+        case kMoney: { Money m; if (!r.bytes(&m.units, 16)) return false; out = Value::ofMoney(m); return true; }
+        case kDate: { DateTime d; if (!r.u64(d.packed)) return false; out = Value::ofDate(d); return true; }
+        case kInterval: {
+            std::uint64_t v;
+            if (!r.u64(v)) return false;
+            out = Value::ofInterval(Interval::unpack(v));
+            return true;
+        }
+        case kText: {
+            std::uint32_t len;
+            if (!r.u32(len) || !r.need(len)) return false;
+            out = Value::ofText(new std::string(r.p, len));
+            r.p += len;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+std::uint64_t CodeCache::keyFor(const std::vector<std::string>& sources) {
+    std::uint64_t h = 0xCBF29CE484222325ull;
+    for (const std::string& source : sources) {
+        // Length framing so ("ab", "c") and ("a", "bc") differ.
+        std::uint64_t len = source.size();
+        h = fnv1a(h, &len, sizeof(len));
+        h = fnv1a(h, source.data(), source.size());
+    }
+    return h;
+}
+
+std::string CodeCache::entryPath(std::uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.mblc", (unsigned long long)key);
+    return dir_ + "/" + name;
+}
+
+bool CodeCache::store(std::uint64_t key, const Chunk& chunk) const {
+    for (const Value& v : chunk.constants) {
+        if (!cacheableConstant(v)) return false;
+    }
+
+    // Temp-and-rename so a concurrent launch never maps a half-written
+    // entry and the last writer simply wins.
+    std::string finalPath = entryPath(key);
+    std::string tempPath = finalPath + ".tmp" + std::to_string((long)::getpid());
+    std::FILE* out = std::fopen(tempPath.c_str(), "wb");
+    if (!out) throw MblError("Cannot create cache entry: " + tempPath);
+    Writer w{out};
+    try {
+        w.u32(kMagic);
+        w.u32(kVersion);
+        w.u64(key);
+        w.u32((std::uint32_t)chunk.registerCount);
+        w.u32((std::uint32_t)chunk.code.size());
+        w.u32((std::uint32_t)chunk.constants.size());
+        w.u32((std::uint32_t)chunk.props.size());
+
+        w.bytes(chunk.code.data(), chunk.code.size() * sizeof(Instruction));
+        for (const Value& v : chunk.constants) writeConstant(w, v);
+
+        for (const PropAccess& site : chunk.props) {
+            w.name(site.name);
+            w.u32((std::uint32_t)site.guards.size());
+            for (const Guard& g : site.guards) {
+                w.u8((std::uint8_t)g.kind);
+                w.u8((std::uint8_t)g.tag);
+                w.i64(g.intLow);
+                w.i64(g.intHigh);
+                w.bytes(&g.moneyLow.units, 16);
+                w.bytes(&g.moneyHigh.units, 16);
+                w.u64(g.dateLow.packed);
+                w.u64(g.dateHigh.packed);
+                w.name(g.field);
+            }
+        }
+    } catch (...) {
+        std::fclose(out);
+        ::unlink(tempPath.c_str());
+        throw;
+    }
+    if (std::fclose(out) != 0 || ::rename(tempPath.c_str(), finalPath.c_str()) != 0) {
+        ::unlink(tempPath.c_str());
+        throw MblError("Code cache write failed: " + finalPath);
+    }
+    return true;
+}
+
+bool CodeCache::load(std::uint64_t key, Chunk& out) const {
+    std::string path = entryPath(key);
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;  // a plain miss
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < 32) {
+        ::close(fd);
+        return false;
+    }
+    std::size_t size = (std::size_t)st.st_size;
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+
+    bool ok = false;
+    Chunk chunk;
+    Reader r{(const char*)map, (const char*)map + size};
+    std::uint32_t magic, version, registerCount, codeCount, constCount, propCount;
+    std::uint64_t storedKey;
+    if (r.u32(magic) && magic == kMagic &&
+        r.u32(version) && version == kVersion &&
+        r.u64(storedKey) && storedKey == key &&
+        r.u32(registerCount) && r.u32(codeCount) &&
+        r.u32(constCount) && r.u32(propCount) &&
+        r.need(codeCount * sizeof(Instruction))) {
+        chunk.registerCount = (int)registerCount;
+        chunk.code.resize(codeCount);
+        r.bytes(chunk.code.data(), codeCount * sizeof(Instruction));
+
+        ok = true;
+        chunk.constants.reserve(constCount);
+        for (std::uint32_t i = 0; ok && i < constCount; ++i) {
+            Value v;
+            ok = readConstant(r, v);
+            if (ok) chunk.constants.push_back(v);
+        }
+        for (std::uint32_t s = 0; ok && s < propCount; ++s) {
+            PropAccess site{Symbol(), PropCache{}, {}};
+            std::uint32_t guardCount = 0;
+            ok = r.name(site.name) && r.u32(guardCount);
+            for (std::uint32_t g = 0; ok && g < guardCount; ++g) {
+                Guard guard;
+                std::uint8_t kind = 0, tag = 0;
+                ok = r.u8(kind) && r.u8(tag) &&
+                     r.i64(guard.intLow) && r.i64(guard.intHigh) &&
+                     r.bytes(&guard.moneyLow.units, 16) &&
+                     r.bytes(&guard.moneyHigh.units, 16) &&
+                     r.u64(guard.dateLow.packed) && r.u64(guard.dateHigh.packed) &&
+                     r.name(guard.field);
+                guard.kind = (Constraint::Kind)kind;
+                guard.tag = (Tag)tag;
+                if (ok) site.guards.push_back(guard);
+            }
+            if (ok) chunk.props.push_back(std::move(site));
+        }
+    }
+
+    ::munmap(map, size);
+    if (ok) out = std::move(chunk);
+    return ok;
+}
+
+} // namespace mbl
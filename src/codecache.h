@@ -0,0 +1,55 @@
+#ifndef MBL_CODECACHE_H
+#define MBL_CODECACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bytecode.h"
+
+namespace mbl {
+
+// On-disk cache of compiled programs, for schedulers that launch the same
+// .mbl Tool thousands of times a day.  A cache entry is the serialized
+// Chunk -- code, constants, property sites with their compiled constraint
+// guards -- keyed by a hash of the program source and every flavored
+// dependency it compiled against.  A warm start mmaps the entry, checks
+// the header, and rebuilds the Chunk without lexing or parsing anything;
+// with a heap-image snapshot (snapshot.h) alongside, a small Tool is
+// running in single-digit milliseconds.
+//
+// Staleness is the key's problem, not the cache's: any edit to the source
+// or a dependency changes the hash and simply misses.  Entries are
+// written to a temp file and renamed into place, so concurrent launches
+// racing on a cold cache are safe.  Runtime-only state is not cached:
+// hotCounts re-size on first run, inline caches start cold, and profile
+// sites re-register (they are process-local ids).
+
+class CodeCache {
+public:
+    // `dir` must exist; entries are files named <hash>.mblc inside it.
+    explicit CodeCache(const std::string& dir) : dir_(dir) {}
+
+    // The cache key for a program: FNV-1a over the source and each
+    // flavored dependency's source, in order.
+    static std::uint64_t keyFor(const std::vector<std::string>& sources);
+
+    // Loads the entry for `key` into `out` (replacing its contents).
+    // False on a miss or an entry that fails validation -- both mean
+    // "compile it", never an error.
+    bool load(std::uint64_t key, Chunk& out) const;
+
+    // Writes the entry for `key`.  Returns false without writing when the
+    // chunk holds something uncacheable (an Object or List constant);
+    // throws MblError on I/O failure.
+    bool store(std::uint64_t key, const Chunk& chunk) const;
+
+private:
+    std::string entryPath(std::uint64_t key) const;
+
+    std::string dir_;
+};
+
+} // namespace mbl
+
+#endif
@@ -0,0 +1,80 @@
+#include "constraint.h"
+
+#include "error.h"
+
+namespace mbl {
+
+namespace {
+
+Guard guardFor(const Constraint& c, Symbol field) {
+    Guard g;
+    g.kind = c.kind;
+    g.tag = c.tag;
+    g.intLow = c.intLow;
+    g.intHigh = c.intHigh;
+    g.moneyLow = c.moneyLow;
+    g.moneyHigh = c.moneyHigh;
+    g.dateLow = c.dateLow;
+    g.dateHigh = c.dateHigh;
+    g.field = field;
+    return g;
+}
+
+// True when the static info proves the guard can never fire.
+bool provablyPasses(const Guard& g, const StaticValueInfo& info) {
+    if (info.isConstant) return g.passes(info.constant);
+    if (!info.tagKnown) return false;
+    switch (g.kind) {
+        case Constraint::Kind::TypeIs:
+            return info.tag == g.tag || info.tag == Tag::Missing;
+        case Constraint::Kind::NotMissing:
+            return info.tag != Tag::Missing;
+        // Range guards self-disable on foreign tags, so a known foreign tag
+        // proves a pass; a known matching tag still needs the runtime check.
+        case Constraint::Kind::IntRange:
+            return info.tag != Tag::Integer;
+        case Constraint::Kind::MoneyRange:
+            return info.tag != Tag::MoneyVal;
+        case Constraint::Kind::DateRange:
+            return info.tag != Tag::Date;
+    }
+    return false;
+}
+
+} // namespace
+
+std::vector<Guard> compileGuards(const ConstraintSet& set, Symbol field,
+                                 const StaticValueInfo& info) {
+    std::vector<Guard> out;
+    const std::vector<Constraint>* rules = set.lookup(field);
+    if (!rules) return out;
+
+    for (const Constraint& c : *rules) {
+        Guard g = guardFor(c, field);
+        if (info.isConstant && !g.passes(info.constant)) {
+            // The program can never run without violating this; fail the
+            // compile instead of the 2am batch.
+            constraintFailure(g, info.constant);
+        }
+        if (provablyPasses(g, info)) continue;
+        out.push_back(g);
+    }
+    return out;
+}
+
+void constraintFailure(const Guard& g, Value v) {
+    std::string what = "Constraint violated on " + symbolName(g.field);
+    switch (g.kind) {
+        case Constraint::Kind::TypeIs: what += ": wrong type"; break;
+        case Constraint::Kind::NotMissing: what += ": value is Missing"; break;
+        case Constraint::Kind::IntRange:
+        case Constraint::Kind::MoneyRange:
+        case Constraint::Kind::DateRange: what += ": value out of range"; break;
+    }
+    if (v.tag == Tag::MoneyVal) what += " (" + v.money.toString() + ")";
+    else if (v.tag == Tag::Integer) what += " (" + std::to_string(v.integer) + ")";
+    else if (v.tag == Tag::Date) what += " (" + v.date.toString() + ")";
+    throw MblError(what);
+}
+
+} // namespace mbl
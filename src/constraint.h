@@ -0,0 +1,103 @@
+#ifndef MBL_CONSTRAINT_H
+#define MBL_CONSTRAINT_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "symbol.h"
+#include "value.h"
+
+namespace mbl {
+
+// Ada-inspired data constraints, compiled rather than observed.  A program
+// declares constraints on fields ("principalBalance is Money between 0 and
+// 10M", "paymentDate is a Date", "account is never Missing"); the compiler
+// then plants Guard records at exactly the assignment sites that could
+// violate them and elides guards it can prove always pass (constant
+// operands, operands whose static type already satisfies a type guard).
+// What remains at runtime is a flat array of compare-and-branch checks per
+// site -- no observer callbacks, no dispatch, nothing allocated.
+
+struct Constraint {
+    enum class Kind : std::uint8_t {
+        TypeIs,      // value must carry this tag (or be Missing -- see below)
+        NotMissing,  // value must not be Missing
+        IntRange,    // Integer in [intLow, intHigh]
+        MoneyRange,  // Money in [moneyLow, moneyHigh]
+        DateRange,   // Date in [dateLow, dateHigh]
+    };
+
+    Kind kind;
+    Tag tag = Tag::Missing;          // TypeIs
+    std::int64_t intLow = 0, intHigh = 0;
+    Money moneyLow, moneyHigh;
+    DateTime dateLow, dateHigh;
+};
+
+// The declared constraints of a program, keyed by field symbol.  Built at
+// compile time; read-only afterwards.
+class ConstraintSet {
+public:
+    void declare(Symbol field, Constraint c) { rules_[field].push_back(c); }
+
+    const std::vector<Constraint>* lookup(Symbol field) const {
+        auto it = rules_.find(field);
+        return it == rules_.end() ? nullptr : &it->second;
+    }
+
+private:
+    std::unordered_map<Symbol, std::vector<Constraint>> rules_;
+};
+
+// A compiled guard: one branch-predictable check, bounds inline.  Field
+// assignments in a hot loop see a short forward-branching loop over these;
+// in the common all-valid run every branch predicts not-taken.
+struct Guard {
+    Constraint::Kind kind;
+    Tag tag;
+    std::int64_t intLow, intHigh;
+    Money moneyLow, moneyHigh;
+    DateTime dateLow, dateHigh;
+    Symbol field;  // for the error message only
+
+    bool passes(Value v) const {
+        switch (kind) {
+            case Constraint::Kind::TypeIs:
+                // Missing is always storable; NotMissing is its own rule.
+                return v.tag == tag || v.tag == Tag::Missing;
+            case Constraint::Kind::NotMissing:
+                return v.tag != Tag::Missing;
+            case Constraint::Kind::IntRange:
+                return v.tag != Tag::Integer || (v.integer >= intLow && v.integer <= intHigh);
+            case Constraint::Kind::MoneyRange:
+                return v.tag != Tag::MoneyVal || (moneyLow <= v.money && v.money <= moneyHigh);
+            case Constraint::Kind::DateRange:
+                return v.tag != Tag::Date || (dateLow <= v.date && v.date <= dateHigh);
+        }
+        return true;
+    }
+};
+
+// What the compiler statically knows about the value flowing into an
+// assignment site.
+struct StaticValueInfo {
+    bool tagKnown = false;
+    Tag tag = Tag::Missing;
+    bool isConstant = false;
+    Value constant;
+};
+
+// Compiles the declared constraints on `field` down to the guards this
+// site actually needs.  Guards provably satisfied by the static info are
+// elided; a constraint a constant provably violates throws immediately, at
+// compile time, which is strictly better than at 2am.
+std::vector<Guard> compileGuards(const ConstraintSet& set, Symbol field,
+                                 const StaticValueInfo& info);
+
+// The failure path, shared by every site; never inlined into the hot loop.
+[[noreturn]] void constraintFailure(const Guard& g, Value v);
+
+} // namespace mbl
+
+#endif
@@ -0,0 +1,206 @@
+#include "crypt.h"
+
+#include "error.h"
+
+#include <cstring>
+
+#if defined(__AES__)
+#include <wmmintrin.h>
+#endif
+#if defined(__ARM_FEATURE_CRYPTO)
+#include <arm_neon.h>
+#endif
+
+namespace mbl {
+
+namespace {
+
+// The Rijndael S-box; used by key expansion on every build and by the
+// portable block path when no crypto ISA is compiled in.
+const std::uint8_t kSbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b,
+    0xfe, 0xd7, 0xab, 0x76, 0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+    0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0, 0xb7, 0xfd, 0x93, 0x26,
+    0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2,
+    0xeb, 0x27, 0xb2, 0x75, 0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+    0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84, 0x53, 0xd1, 0x00, 0xed,
+    0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f,
+    0x50, 0x3c, 0x9f, 0xa8, 0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+    0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2, 0xcd, 0x0c, 0x13, 0xec,
+    0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14,
+    0xde, 0x5e, 0x0b, 0xdb, 0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+    0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79, 0xe7, 0xc8, 0x37, 0x6d,
+    0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f,
+    0x4b, 0xbd, 0x8b, 0x8a, 0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+    0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e, 0xe1, 0xf8, 0x98, 0x11,
+    0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f,
+    0xb0, 0x54, 0xbb, 0x16,
+};
+
+const std::uint8_t kRcon[15] = {
+    0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40,
+    0x80, 0x1b, 0x36, 0x6c, 0xd8, 0xab, 0x4d,
+};
+
+std::uint8_t xtime(std::uint8_t a) {
+    return (std::uint8_t)((a << 1) ^ ((a >> 7) * 0x1b));
+}
+
+#if !defined(__AES__) && !defined(__ARM_FEATURE_CRYPTO)
+// Portable single-block encryption: SubBytes / ShiftRows / MixColumns over
+// a 16-byte state, column-major as in the spec.
+void encryptBlockSoft(const std::uint8_t rk[15][16], int rounds,
+                      const std::uint8_t in[16], std::uint8_t out[16]) {
+    std::uint8_t s[16];
+    for (int i = 0; i < 16; ++i) s[i] = in[i] ^ rk[0][i];
+    for (int round = 1; round <= rounds; ++round) {
+        std::uint8_t t[16];
+        // SubBytes + ShiftRows fused: row r rotates left by r.
+        for (int c = 0; c < 4; ++c) {
+            t[4 * c + 0] = kSbox[s[4 * c + 0]];
+            t[4 * c + 1] = kSbox[s[(4 * (c + 1) + 1) & 15]];
+            t[4 * c + 2] = kSbox[s[(4 * (c + 2) + 2) & 15]];
+            t[4 * c + 3] = kSbox[s[(4 * (c + 3) + 3) & 15]];
+        }
+        if (round < rounds) {
+            for (int c = 0; c < 4; ++c) {
+                std::uint8_t a0 = t[4 * c], a1 = t[4 * c + 1];
+                std::uint8_t a2 = t[4 * c + 2], a3 = t[4 * c + 3];
+                std::uint8_t all = (std::uint8_t)(a0 ^ a1 ^ a2 ^ a3);
+                s[4 * c + 0] = (std::uint8_t)(a0 ^ all ^ xtime((std::uint8_t)(a0 ^ a1)));
+                s[4 * c + 1] = (std::uint8_t)(a1 ^ all ^ xtime((std::uint8_t)(a1 ^ a2)));
+                s[4 * c + 2] = (std::uint8_t)(a2 ^ all ^ xtime((std::uint8_t)(a2 ^ a3)));
+                s[4 * c + 3] = (std::uint8_t)(a3 ^ all ^ xtime((std::uint8_t)(a3 ^ a0)));
+            }
+        } else {
+            std::memcpy(s, t, 16);
+        }
+        for (int i = 0; i < 16; ++i) s[i] ^= rk[round][i];
+    }
+    std::memcpy(out, s, 16);
+}
+#endif
+
+#if defined(__ARM_FEATURE_CRYPTO)
+void encryptBlockArm(const std::uint8_t rk[15][16], int rounds,
+                     const std::uint8_t in[16], std::uint8_t out[16]) {
+    uint8x16_t s = vld1q_u8(in);
+    for (int round = 0; round < rounds - 1; ++round) {
+        s = vaesmcq_u8(vaeseq_u8(s, vld1q_u8(rk[round])));
+    }
+    s = vaeseq_u8(s, vld1q_u8(rk[rounds - 1]));
+    s = veorq_u8(s, vld1q_u8(rk[rounds]));
+    vst1q_u8(out, s);
+}
+#endif
+
+void incrementCounter(std::uint8_t c[16]) {
+    for (int i = 15; i >= 0; --i) {
+        if (++c[i]) break;
+    }
+}
+
+} // namespace
+
+AesCtr::AesCtr(const std::uint8_t* key, std::size_t keyLen, const std::uint8_t iv[16]) {
+    if (keyLen != 16 && keyLen != 32) {
+        throw MblError("Encryption keys are 16 or 32 bytes");
+    }
+    rounds_ = keyLen == 16 ? 10 : 14;
+
+    // Standard Rijndael key expansion into (rounds_ + 1) round keys; done
+    // in software on every build -- it runs once per stream and keeps the
+    // hardware paths to the per-block work that actually repeats.
+    const int nk = (int)(keyLen / 4);
+    std::uint8_t* w = &roundKeys_[0][0];
+    std::memcpy(w, key, keyLen);
+    for (int i = nk; i < 4 * (rounds_ + 1); ++i) {
+        std::uint8_t t[4];
+        std::memcpy(t, w + 4 * (i - 1), 4);
+        if (i % nk == 0) {
+            std::uint8_t first = t[0];
+            t[0] = (std::uint8_t)(kSbox[t[1]] ^ kRcon[i / nk]);
+            t[1] = kSbox[t[2]];
+            t[2] = kSbox[t[3]];
+            t[3] = kSbox[first];
+        } else if (nk == 8 && i % nk == 4) {
+            for (int k = 0; k < 4; ++k) t[k] = kSbox[t[k]];
+        }
+        for (int k = 0; k < 4; ++k) {
+            w[4 * i + k] = (std::uint8_t)(w[4 * (i - nk) + k] ^ t[k]);
+        }
+    }
+
+    std::memcpy(counter_, iv, 16);
+}
+
+void AesCtr::refill() {
+    // Four counter blocks per refill.  The counters are independent, so on
+    // AES-NI the four aesenc chains interleave and the cipher keeps the
+    // AES units saturated instead of waiting out each round's latency.
+    std::uint8_t blocks[4][16];
+    for (int b = 0; b < 4; ++b) {
+        std::memcpy(blocks[b], counter_, 16);
+        incrementCounter(counter_);
+    }
+#if defined(__AES__)
+    const __m128i* rk = (const __m128i*)roundKeys_;
+    __m128i k = _mm_load_si128(rk);
+    __m128i s0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)blocks[0]), k);
+    __m128i s1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)blocks[1]), k);
+    __m128i s2 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)blocks[2]), k);
+    __m128i s3 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)blocks[3]), k);
+    for (int round = 1; round < rounds_; ++round) {
+        k = _mm_load_si128(rk + round);
+        s0 = _mm_aesenc_si128(s0, k);
+        s1 = _mm_aesenc_si128(s1, k);
+        s2 = _mm_aesenc_si128(s2, k);
+        s3 = _mm_aesenc_si128(s3, k);
+    }
+    k = _mm_load_si128(rk + rounds_);
+    _mm_store_si128((__m128i*)(stream_ + 0), _mm_aesenclast_si128(s0, k));
+    _mm_store_si128((__m128i*)(stream_ + 16), _mm_aesenclast_si128(s1, k));
+    _mm_store_si128((__m128i*)(stream_ + 32), _mm_aesenclast_si128(s2, k));
+    _mm_store_si128((__m128i*)(stream_ + 48), _mm_aesenclast_si128(s3, k));
+#elif defined(__ARM_FEATURE_CRYPTO)
+    for (int b = 0; b < 4; ++b) {
+        encryptBlockArm(roundKeys_, rounds_, blocks[b], stream_ + 16 * b);
+    }
+#else
+    for (int b = 0; b < 4; ++b) {
+        encryptBlockSoft(roundKeys_, rounds_, blocks[b], stream_ + 16 * b);
+    }
+#endif
+}
+
+void AesCtr::process(const std::uint8_t* in, std::uint8_t* out, std::size_t n) {
+    while (n) {
+        if (streamUsed_ == sizeof(stream_)) {
+            refill();
+            streamUsed_ = 0;
+        }
+        std::size_t take = sizeof(stream_) - streamUsed_;
+        if (take > n) take = n;
+        const std::uint8_t* ks = stream_ + streamUsed_;
+        std::size_t i = 0;
+        for (; i + 8 <= take; i += 8) {
+            std::uint64_t data, key;
+            std::memcpy(&data, in + i, 8);
+            std::memcpy(&key, ks + i, 8);
+            data ^= key;
+            std::memcpy(out + i, &data, 8);
+        }
+        for (; i < take; ++i) out[i] = (std::uint8_t)(in[i] ^ ks[i]);
+        in += take;
+        out += take;
+        streamUsed_ += take;
+        n -= take;
+    }
+}
+
+} // namespace mbl
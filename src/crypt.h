@@ -0,0 +1,57 @@
+#ifndef MBL_CRYPT_H
+#define MBL_CRYPT_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mbl {
+
+// The encryption primitive behind MBL's file-transfer library: AES in
+// counter mode, streamed chunk by chunk.  CTR turns the block cipher into
+// a keystream, so encrypt and decrypt are the same call, chunks can be any
+// length, and a 30 GB export is processed in whatever pieces the report
+// writer hands over -- nothing is ever held in memory beyond the caller's
+// own buffer.
+//
+// The per-block work runs on AES-NI or the ARMv8 crypto extensions when
+// the build targets them (same compile-time guards as the AVX2 batch
+// kernels in money.cpp; build with -DMBL_NATIVE=ON), with independent
+// counter blocks in flight so the hardware AES units pipeline and the
+// loop runs at memory bandwidth.  Without either ISA it falls back to a
+// portable byte-table implementation -- correct, but the slow path the
+// export schedule should not sit on.
+//
+// CTR is malleable and unauthenticated on its own; transports that need
+// integrity pair it with a MAC over the ciphertext.  Never reuse a
+// (key, iv) pair across two payloads.
+
+class AesCtr {
+public:
+    // keyLen must be 16 (AES-128) or 32 (AES-256); throws MblError
+    // otherwise.  `iv` is the initial 16-byte counter block, typically
+    // 12 random bytes and a zero 32-bit counter.
+    AesCtr(const std::uint8_t* key, std::size_t keyLen, const std::uint8_t iv[16]);
+
+    AesCtr(const AesCtr&) = delete;
+    AesCtr& operator=(const AesCtr&) = delete;
+
+    // XORs the next `n` keystream bytes into out[i] = in[i] ^ ks.
+    // Chunk boundaries are invisible: ten 3 MB calls and one 30 MB call
+    // produce identical output.  In-place (out == in) is fine.
+    void process(const std::uint8_t* in, std::uint8_t* out, std::size_t n);
+
+private:
+    void refill();
+
+    alignas(16) std::uint8_t roundKeys_[15][16];
+    std::uint8_t counter_[16];
+    // Keystream generated ahead of consumption, so a chunk ending mid-block
+    // costs nothing on the next call.
+    alignas(16) std::uint8_t stream_[64];
+    std::size_t streamUsed_ = sizeof(stream_);
+    int rounds_;
+};
+
+} // namespace mbl
+
+#endif
@@ -0,0 +1,234 @@
+#include "datetime.h"
+
+#include "error.h"
+
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+
+namespace mbl {
+
+namespace {
+
+bool isLeap(int y) { return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0; }
+
+int daysInMonth(int y, int m) {
+    static const int lengths[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (m == 2 && isLeap(y)) return 29;
+    return lengths[m - 1];
+}
+
+// Days since 1970-01-01 for a civil date; the standard shift-the-epoch
+// formulation that is branch-light and exact over the whole year range.
+std::int64_t civilToDays(int y, int m, int d) {
+    y -= m <= 2;
+    std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (std::int64_t)doe - 719468;
+}
+
+void daysToCivil(std::int64_t z, int& y, int& m, int& d) {
+    z += 719468;
+    std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    std::int64_t yy = (std::int64_t)yoe + era * 400;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    m = (int)(mp + (mp < 10 ? 3 : -9));
+    y = (int)(yy + (m <= 2));
+}
+
+} // namespace
+
+DateTime DateTime::make(int year, int month, int day,
+                        int hour, int minute, int second, int millisecond) {
+    if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month) ||
+        hour < 0 || hour > 23 || minute < 0 || minute > 59 ||
+        second < 0 || second > 59 || millisecond < 0 || millisecond > 999) {
+        throw MblError("Not a valid date/time");
+    }
+    DateTime t;
+    t.packed = ((std::uint64_t)(std::uint32_t)year << 36 & 0x01FFFFF000000000ULL) |
+               ((std::uint64_t)month << 32) | ((std::uint64_t)day << 27) |
+               ((std::uint64_t)hour << 22) | ((std::uint64_t)minute << 16) |
+               ((std::uint64_t)second << 10) | (std::uint64_t)millisecond;
+    return t;
+}
+
+std::string DateTime::toString() const {
+    char buf[40];
+    if (hour() == 0 && minute() == 0 && second() == 0 && millisecond() == 0) {
+        std::snprintf(buf, sizeof buf, "%04d-%02d-%02d", year(), month(), day());
+    } else {
+        std::snprintf(buf, sizeof buf, "%04d-%02d-%02d %02d:%02d:%02d",
+                      year(), month(), day(), hour(), minute(), second());
+    }
+    return buf;
+}
+
+std::uint64_t Interval::pack() const {
+    return ((std::uint64_t)(std::uint16_t)months << 48) |
+           ((std::uint64_t)(std::uint16_t)days << 32) |
+           (std::uint64_t)(std::uint32_t)(std::int32_t)seconds;
+}
+
+Interval Interval::unpack(std::uint64_t word) {
+    Interval iv;
+    iv.months = (std::int16_t)(word >> 48);
+    iv.days = (std::int16_t)(word >> 32);
+    iv.seconds = (std::int32_t)(word & 0xFFFFFFFFULL);
+    return iv;
+}
+
+DateTime addInterval(DateTime base, Interval delta) {
+    int y = base.year(), m = base.month(), d = base.day();
+
+    // Months first, clamping the day into the target month.
+    std::int64_t totalMonths = (std::int64_t)y * 12 + (m - 1) + delta.months;
+    y = (int)((totalMonths >= 0 ? totalMonths : totalMonths - 11) / 12);
+    m = (int)(totalMonths - (std::int64_t)y * 12) + 1;
+    if (d > daysInMonth(y, m)) d = daysInMonth(y, m);
+
+    // Then whole days, then seconds (which may roll the date again).
+    std::int64_t dayNumber = civilToDays(y, m, d) + delta.days;
+    std::int64_t secondOfDay = (std::int64_t)base.hour() * 3600 +
+                               base.minute() * 60 + base.second() + delta.seconds;
+    dayNumber += secondOfDay >= 0 ? secondOfDay / 86400
+                                  : (secondOfDay - 86399) / 86400;
+    secondOfDay -= (secondOfDay >= 0 ? secondOfDay / 86400
+                                     : (secondOfDay - 86399) / 86400) * 86400;
+
+    daysToCivil(dayNumber, y, m, d);
+    return DateTime::make(y, m, d, (int)(secondOfDay / 3600),
+                          (int)(secondOfDay / 60 % 60), (int)(secondOfDay % 60),
+                          base.millisecond());
+}
+
+std::int64_t daysBetween(DateTime a, DateTime b) {
+    return civilToDays(b.year(), b.month(), b.day()) -
+           civilToDays(a.year(), a.month(), a.day());
+}
+
+DateTime dateTimeNow() {
+    std::time_t t = std::time(nullptr);
+    std::tm tmv;
+    localtime_r(&t, &tmv);
+    return DateTime::make(tmv.tm_year + 1900, tmv.tm_mon + 1, tmv.tm_mday,
+                          tmv.tm_hour, tmv.tm_min, tmv.tm_sec);
+}
+
+namespace {
+
+struct LiteralParser {
+    const char* p;
+    DateTime now;
+
+    void skipSpace() { while (*p == ' ' || *p == '\t') ++p; }
+
+    bool word(std::string& out) {
+        skipSpace();
+        out.clear();
+        while (std::isalpha((unsigned char)*p)) out += (char)std::tolower((unsigned char)*p++);
+        return !out.empty();
+    }
+
+    bool number(long& out) {
+        skipSpace();
+        if (!std::isdigit((unsigned char)*p) &&
+            !((*p == '-' || *p == '+') && std::isdigit((unsigned char)p[1]))) return false;
+        out = std::strtol(p, (char**)&p, 10);
+        return true;
+    }
+
+    // "month" -> {1,0,0}; plural and singular both accepted.
+    static bool unitSpan(const std::string& unit, Interval& out) {
+        std::string u = unit;
+        if (u.size() > 1 && u.back() == 's') u.pop_back();
+        if (u == "year") { out = Interval{12, 0, 0}; return true; }
+        if (u == "month") { out = Interval{1, 0, 0}; return true; }
+        if (u == "week") { out = Interval{0, 7, 0}; return true; }
+        if (u == "day") { out = Interval{0, 1, 0}; return true; }
+        if (u == "hour") { out = Interval{0, 0, 3600}; return true; }
+        if (u == "minute") { out = Interval{0, 0, 60}; return true; }
+        if (u == "second") { out = Interval{0, 0, 1}; return true; }
+        return false;
+    }
+
+    static Interval scale(Interval unit, long n) {
+        return Interval{unit.months * (std::int32_t)n, unit.days * (std::int32_t)n,
+                        unit.seconds * (std::int64_t)n};
+    }
+};
+
+} // namespace
+
+TimeLiteral parseTimeLiteral(const std::string& text, DateTime now) {
+    LiteralParser lp{text.c_str(), now};
+
+    // ISO form first: starts with four digits and a dash.
+    {
+        int y, m, d, hh = 0, mm = 0, ss = 0;
+        int n = 0;
+        if (std::sscanf(lp.p, "%4d-%2d-%2d%n", &y, &m, &d, &n) == 3 && n > 0) {
+            const char* rest = lp.p + n;
+            std::sscanf(rest, " %2d:%2d:%2d", &hh, &mm, &ss);
+            return TimeLiteral{false, DateTime::make(y, m, d, hh, mm, ss), Interval{}};
+        }
+    }
+
+    bool anchored = false;
+    DateTime anchor = now;
+    Interval span;
+    bool sawAnything = false;
+
+    for (;;) {
+        lp.skipSpace();
+        if (*lp.p == '\0') break;
+
+        long n;
+        std::string w;
+        if (lp.number(n)) {
+            // "<n> <unit>" span component.
+            Interval unit;
+            if (!lp.word(w) || !LiteralParser::unitSpan(w, unit))
+                throw MblError("Not a valid time literal: T\"" + text + "\"");
+            span = span + LiteralParser::scale(unit, n);
+            sawAnything = true;
+            continue;
+        }
+        if (!lp.word(w)) throw MblError("Not a valid time literal: T\"" + text + "\"");
+
+        Interval unit;
+        if (w == "today" || w == "now") {
+            anchored = true;
+        } else if (w == "tomorrow") {
+            anchored = true;
+            anchor = addInterval(anchor, Interval{0, 1, 0});
+        } else if (w == "yesterday") {
+            anchored = true;
+            anchor = addInterval(anchor, Interval{0, -1, 0});
+        } else if ((w == "next" || w == "last")) {
+            std::string u;
+            if (!lp.word(u) || !LiteralParser::unitSpan(u, unit))
+                throw MblError("Not a valid time literal: T\"" + text + "\"");
+            anchored = true;
+            anchor = addInterval(anchor, w == "next" ? unit : -unit);
+        } else if (LiteralParser::unitSpan(w, unit)) {
+            // A bare unit ("month") counts as one of it.
+            span = span + unit;
+        } else {
+            throw MblError("Not a valid time literal: T\"" + text + "\"");
+        }
+        sawAnything = true;
+    }
+
+    if (!sawAnything) throw MblError("Empty time literal");
+    if (anchored) return TimeLiteral{false, addInterval(anchor, span), Interval{}};
+    return TimeLiteral{true, DateTime{}, span};
+}
+
+} // namespace mbl
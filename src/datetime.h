@@ -0,0 +1,95 @@
+#ifndef MBL_DATETIME_H
+#define MBL_DATETIME_H
+
+#include <cstdint>
+#include <string>
+
+namespace mbl {
+
+// MBL's date/time support.  A DateTime is one 64-bit word packing the
+// civil fields directly -- year, month, day, hour, minute, second,
+// millisecond -- so calendar arithmetic ("add one month", which depends on
+// the calendar, not on elapsed ticks) never unpacks through a timezone
+// library or touches the heap.  An Interval is the calendar-aware span
+// type: months, days and seconds kept separate because a month is not a
+// fixed number of days.
+//
+// T-literals (T"Next Month 15 Days", T"1 month", T"2026-08-29") are parsed
+// ONCE, by the compiler, via parseTimeLiteral(); at runtime they are plain
+// constants in the chunk's pool.  `period.paymentDate += T"1 month"` is a
+// single addInterval call on two 64-bit values.
+
+struct DateTime {
+    // Bit layout, low to high:
+    //   millisecond 10 | second 6 | minute 6 | hour 5 | day 5 | month 4 |
+    //   year 21 (signed, astronomically generous) | spare 7
+    std::uint64_t packed = 0;
+
+    static DateTime make(int year, int month, int day,
+                         int hour = 0, int minute = 0, int second = 0,
+                         int millisecond = 0);
+
+    int year() const { return (int)((std::int64_t)(packed << 7) >> 43); }
+    int month() const { return (int)((packed >> 32) & 0xF); }
+    int day() const { return (int)((packed >> 27) & 0x1F); }
+    int hour() const { return (int)((packed >> 22) & 0x1F); }
+    int minute() const { return (int)((packed >> 16) & 0x3F); }
+    int second() const { return (int)((packed >> 10) & 0x3F); }
+    int millisecond() const { return (int)(packed & 0x3FF); }
+
+    // Chronological order matches numeric order on the packed word for the
+    // same sign of year, which the layout guarantees by putting year on top.
+    bool operator<(DateTime o) const { return packed < o.packed; }
+    bool operator==(DateTime o) const { return packed == o.packed; }
+    bool operator!=(DateTime o) const { return packed != o.packed; }
+    bool operator<=(DateTime o) const { return packed <= o.packed; }
+
+    std::string toString() const;  // "2026-08-29" or "2026-08-29 14:30:00"
+};
+
+struct Interval {
+    std::int32_t months = 0;
+    std::int32_t days = 0;
+    std::int64_t seconds = 0;
+
+    // Intervals travel inside Value as one packed word:
+    // months 16 | days 16 | seconds 32 (each signed).
+    std::uint64_t pack() const;
+    static Interval unpack(std::uint64_t word);
+
+    Interval operator+(Interval o) const {
+        return Interval{months + o.months, days + o.days, seconds + o.seconds};
+    }
+    Interval operator-() const { return Interval{-months, -days, -seconds}; }
+};
+
+// Calendar addition, allocation-free.  Months are applied first with
+// end-of-month clamping (Jan 31 + 1 month = Feb 28), then days, then
+// seconds -- the conventional order, and the one loan schedules expect.
+DateTime addInterval(DateTime base, Interval delta);
+
+// Whole days between two dates (b - a), ignoring time of day.
+std::int64_t daysBetween(DateTime a, DateTime b);
+
+// Result of compiling a T-literal: either an anchored point in time or a
+// pure span, decided by the literal's wording.
+struct TimeLiteral {
+    bool isInterval;
+    DateTime point;  // anchored result, valid when !isInterval
+    Interval span;   // valid when isInterval
+};
+
+// Parses the inside of a T"..." literal.  Understands ISO dates
+// ("2026-08-29", optionally with " hh:mm:ss"), spans ("1 month", "15
+// days 4 hours"), and anchored phrases relative to `now` ("Today",
+// "Tomorrow", "Next Month", "Last Year", "Next Month 15 Days" -- an anchor
+// followed by a span offset).  Case-insensitive throughout.  Throws
+// MblError on anything it cannot understand.
+TimeLiteral parseTimeLiteral(const std::string& text, DateTime now);
+
+// The current civil time in the process-local timezone.
+DateTime dateTimeNow();
+
+} // namespace mbl
+
+#endif
@@ -0,0 +1,131 @@
+#include "derived.h"
+
+#include "error.h"
+
+namespace mbl {
+
+namespace {
+
+Value addDelta(Value accumulator, Value v, std::int64_t sign) {
+    switch (v.tag) {
+        case Tag::MoneyVal: {
+            Money delta = sign < 0 ? -v.money : v.money;
+            return Value::ofMoney(accumulator.money + delta);
+        }
+        case Tag::Integer:
+            return Value::ofInt(accumulator.integer + sign * v.integer);
+        case Tag::Float:
+            return Value::ofFloat(accumulator.real + (double)sign * v.real);
+        default:
+            throw MblError("Derived sums need a numeric column");
+    }
+}
+
+Value zeroLike(Tag type) {
+    switch (type) {
+        case Tag::MoneyVal: return Value::ofMoney(Money());
+        case Tag::Integer: return Value::ofInt(0);
+        case Tag::Float: return Value::ofFloat(0.0);
+        default: return Value::missing();
+    }
+}
+
+// Ordering over one column's values; Date columns order too.
+bool less(Value a, Value b) {
+    switch (a.tag) {
+        case Tag::MoneyVal: return a.money < b.money;
+        case Tag::Integer: return a.integer < b.integer;
+        case Tag::Float: return a.real < b.real;
+        case Tag::Date: return a.date < b.date;
+        default: throw MblError("Derived min/max needs an orderable column");
+    }
+}
+
+} // namespace
+
+Derivation::Derivation(Kind kind, Table* source, std::size_t col,
+                       Object* target, Symbol field)
+    : kind_(kind), source_(source), col_(col), target_(target), field_(field) {
+    recompute();
+    source_->observe(col_, this);
+}
+
+void Derivation::onAppend(std::size_t, Value v) {
+    switch (kind_) {
+        case Kind::Sum:
+            current_ = addDelta(current_, v, +1);
+            break;
+        case Kind::Count:
+            current_ = Value::ofInt(current_.integer + 1);
+            break;
+        case Kind::Min:
+            if (current_.isMissing() || less(v, current_)) current_ = v;
+            break;
+        case Kind::Max:
+            if (current_.isMissing() || less(current_, v)) current_ = v;
+            break;
+    }
+    writeThrough();
+}
+
+void Derivation::onUpdate(std::size_t, Value oldValue, Value newValue) {
+    switch (kind_) {
+        case Kind::Sum:
+            current_ = addDelta(addDelta(current_, oldValue, -1), newValue, +1);
+            break;
+        case Kind::Count:
+            return;  // an in-place update does not change the row count
+        case Kind::Min:
+            if (less(newValue, current_)) {
+                current_ = newValue;  // improving update, O(1)
+            } else if (!less(oldValue, current_) && !less(current_, oldValue)) {
+                recompute();  // the current extreme was displaced
+            }
+            break;
+        case Kind::Max:
+            if (less(current_, newValue)) {
+                current_ = newValue;
+            } else if (!less(oldValue, current_) && !less(current_, oldValue)) {
+                recompute();
+            }
+            break;
+    }
+    writeThrough();
+}
+
+void Derivation::onBulkWrite() {
+    recompute();
+    writeThrough();
+}
+
+void Derivation::recompute() {
+    std::size_t rows = source_->rowCount();
+    switch (kind_) {
+        case Kind::Sum:
+            current_ = rows ? source_->sumColumn(col_)
+                            : zeroLike(source_->columnType(col_));
+            break;
+        case Kind::Count:
+            current_ = Value::ofInt((std::int64_t)rows);
+            break;
+        case Kind::Min:
+        case Kind::Max: {
+            current_ = Value::missing();
+            for (std::size_t row = 0; row < rows; ++row) {
+                Value v = source_->at(row, col_);
+                if (current_.isMissing() ||
+                    (kind_ == Kind::Min ? less(v, current_) : less(current_, v))) {
+                    current_ = v;
+                }
+            }
+            break;
+        }
+    }
+    writeThrough();
+}
+
+void Derivation::writeThrough() {
+    target_->set(field_, current_);
+}
+
+} // namespace mbl
@@ -0,0 +1,60 @@
+#ifndef MBL_DERIVED_H
+#define MBL_DERIVED_H
+
+#include <cstddef>
+
+#include "object.h"
+#include "table.h"
+#include "value.h"
+
+namespace mbl {
+
+// Incremental recomputation for declared derived fields.  A Derivation
+// binds one aggregate over a Table column to one Object property (e.g.
+// portfolio.interestTotal = Sum of payments.interest) and keeps it current
+// from the *deltas* the table reports, instead of re-running the defining
+// expression over all rows per update:
+//
+//   Sum / Count   O(1) per append and per cell update.
+//   Min / Max     O(1) per append and per improving update; an update that
+//                 displaces the current extreme has to rescan the column,
+//                 because the runner-up is not derivable from the delta.
+//
+// Table calls back into registered derivations from appendRow and set;
+// the derived property on the target object is written through on every
+// change, so readers never see a stale value.
+
+class Derivation : public TableObserver {
+public:
+    enum class Kind { Sum, Count, Min, Max };
+
+    // Binds `target.<field>` to `kind` over column `col` of `source`, seeds
+    // the accumulator from the rows already present, and registers with the
+    // table.  The derivation must outlive neither endpoint.
+    Derivation(Kind kind, Table* source, std::size_t col,
+               Object* target, Symbol field);
+
+    // Delta callbacks, invoked by Table.  Aggregates are row-agnostic, so
+    // the row number goes unused here.
+    void onAppend(std::size_t row, Value v) override;
+    void onUpdate(std::size_t row, Value oldValue, Value newValue) override;
+    // No per-cell deltas exist for a bulk write; fall back to one pass.
+    void onBulkWrite() override;
+
+    Value current() const { return current_; }
+
+private:
+    void recompute();
+    void writeThrough();
+
+    Kind kind_;
+    Table* source_;
+    std::size_t col_;
+    Object* target_;
+    Symbol field_;
+    Value current_;
+};
+
+} // namespace mbl
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef MBL_ERROR_H
+#define MBL_ERROR_H
+
+#include <stdexcept>
+#include <string>
+
+namespace mbl {
+
+// Every fault the runtime can raise funnels through MblError so embedders
+// have exactly one thing to catch.  The what() string is already formatted
+// for an end user of the language, not for a C++ developer.
+class MblError : public std::runtime_error {
+public:
+    explicit MblError(const std::string& message) : std::runtime_error(message) {}
+};
+
+} // namespace mbl
+
+#endif
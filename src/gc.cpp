@@ -0,0 +1,207 @@
+#include "gc.h"
+
+#include "error.h"
+
+#include <cstring>
+
+namespace mbl {
+
+namespace {
+
+thread_local Heap* activeHeap = nullptr;
+
+} // namespace
+
+Heap* currentHeap() { return activeHeap; }
+
+GcScope::GcScope(Heap& heap) : previous_(activeHeap) { activeHeap = &heap; }
+GcScope::~GcScope() { activeHeap = previous_; }
+
+Heap::Heap(std::size_t nurseryBytes) : nurserySize_(nurseryBytes) {
+    nursery_ = new char[nurserySize_];
+}
+
+Heap::~Heap() {
+    // Nursery objects are abandoned wholesale (their slot arrays live in
+    // the nursery too); old-generation objects free their heap slots.
+    for (Object* obj : oldGen_) delete obj;
+    delete[] nursery_;
+}
+
+Object* Heap::allocateObject() {
+    std::size_t need = sizeof(Object);
+    std::size_t at = (bump_ + alignof(Object) - 1) & ~(alignof(Object) - 1);
+    if (at + need > nurserySize_) {
+        collectMinor();
+        at = 0;
+        if (need > nurserySize_) throw MblError("Nursery smaller than one object");
+    }
+    Object* obj = new (nursery_ + at) Object();
+    obj->slots.gcBacked = true;
+    bump_ = at + need;
+    return obj;
+}
+
+Value* Heap::allocateSlots(std::uint32_t capacity) {
+    std::size_t need = (std::size_t)capacity * sizeof(Value);
+    std::size_t at = (bump_ + alignof(Value) - 1) & ~(alignof(Value) - 1);
+    if (at + need > nurserySize_) return nullptr;  // caller falls back to heap
+    bump_ = at + need;
+    return (Value*)(nursery_ + at);
+}
+
+void Heap::addRootRange(Value* begin, std::size_t count) {
+    roots_.emplace_back(begin, count);
+}
+
+void Heap::removeRootRange(Value* begin) {
+    for (std::size_t i = roots_.size(); i-- > 0;) {
+        if (roots_[i].first == begin) {
+            roots_.erase(roots_.begin() + (std::ptrdiff_t)i);
+            return;
+        }
+    }
+}
+
+void Heap::rememberObject(Object* holder) {
+    holder->gcRemembered = true;
+    rememberedObjects_.push_back(holder);
+}
+
+void Heap::rememberList(List* holder) {
+    rememberedLists_.insert(holder);
+}
+
+// A forwarded nursery object has shape == nullptr and its new address in
+// `proto`; shape is never null on a live object, so the encoding is free.
+Object* Heap::promote(Object* obj) {
+    if (obj->shape == nullptr) return obj->proto;
+
+    Object* copy = new Object();
+    copy->shape = obj->shape;
+    copy->slots = obj->slots;
+    copy->proto = obj->proto;
+    copy->isPrototype = obj->isPrototype;
+    copy->cowDepth = obj->cowDepth;
+
+    if (copy->slots.gcBacked && copy->slots.data) {
+        Value* moved = new Value[copy->slots.capacity];
+        std::memcpy(moved, copy->slots.data, copy->slots.count * sizeof(Value));
+        copy->slots.data = moved;
+        copy->slots.gcBacked = false;
+    } else {
+        copy->slots.gcBacked = false;
+    }
+    // The original must not free the slots it no longer owns.
+    obj->slots.data = nullptr;
+    obj->slots.gcBacked = false;
+
+    obj->shape = nullptr;
+    obj->proto = copy;
+
+    oldGen_.push_back(copy);
+    scanQueue_.push_back(copy);
+    ++promotedObjects_;
+    return copy;
+}
+
+void Heap::scanObjectRef(Object*& obj) {
+    if (obj && inNursery(obj)) obj = promote(obj);
+}
+
+void Heap::scanValue(Value& v) {
+    if (v.tag == Tag::Obj) {
+        scanObjectRef(v.object);
+    } else if (v.tag == Tag::ListVal && v.list) {
+        scanList(v.list);
+    }
+}
+
+void Heap::scanList(List* list) {
+    if (!visitedLists_.insert(list).second) return;
+    for (std::size_t c = 0; c < list->chunkCount(); ++c) {
+        Value* values = list->chunkData(c);
+        std::uint32_t fill = list->chunkFill(c);
+        for (std::uint32_t i = 0; i < fill; ++i) scanValue(values[i]);
+    }
+}
+
+void Heap::collectMinor() {
+    scanQueue_.clear();
+    visitedLists_.clear();
+
+    for (auto& range : roots_) {
+        for (std::size_t i = 0; i < range.second; ++i) scanValue(range.first[i]);
+    }
+    for (Object* holder : rememberedObjects_) {
+        scanObjectRef(holder->proto);
+        for (std::uint32_t i = 0; i < holder->slots.count; ++i) {
+            scanValue(holder->slots[i]);
+        }
+        holder->gcRemembered = false;
+    }
+    rememberedObjects_.clear();
+    for (List* list : rememberedLists_) scanList(list);
+    rememberedLists_.clear();
+
+    // Cheney-style: promoted objects queue their referents until the
+    // frontier empties.
+    while (!scanQueue_.empty()) {
+        Object* obj = scanQueue_.back();
+        scanQueue_.pop_back();
+        scanObjectRef(obj->proto);
+        for (std::uint32_t i = 0; i < obj->slots.count; ++i) scanValue(obj->slots[i]);
+    }
+
+    bump_ = 0;
+    ++minorCollections_;
+
+    // Prototype-chain cache ways pin holder addresses (object.h), and a
+    // collection moves nursery holders and can free old-generation ones in
+    // the major sweep that follows.  One epoch bump makes probe() miss
+    // every such way; receiver-own ways key on shape alone and survive.
+    ++protoEpoch;
+}
+
+void Heap::markObject(Object* obj) {
+    while (obj && !obj->gcMarked) {
+        obj->gcMarked = true;
+        for (std::uint32_t i = 0; i < obj->slots.count; ++i) markValue(obj->slots[i]);
+        obj = obj->proto;  // tail-walk the prototype chain
+    }
+}
+
+void Heap::markValue(Value v) {
+    if (v.tag == Tag::Obj) {
+        markObject(v.object);
+    } else if (v.tag == Tag::ListVal && v.list) {
+        if (!visitedLists_.insert(v.list).second) return;
+        for (std::size_t c = 0; c < v.list->chunkCount(); ++c) {
+            Value* values = v.list->chunkData(c);
+            std::uint32_t fill = v.list->chunkFill(c);
+            for (std::uint32_t i = 0; i < fill; ++i) markValue(values[i]);
+        }
+    }
+}
+
+void Heap::collectMajor() {
+    collectMinor();  // empty the nursery so marking sees one generation
+
+    visitedLists_.clear();
+    for (auto& range : roots_) {
+        for (std::size_t i = 0; i < range.second; ++i) markValue(range.first[i]);
+    }
+
+    std::size_t kept = 0;
+    for (Object* obj : oldGen_) {
+        if (obj->gcMarked) {
+            obj->gcMarked = false;
+            oldGen_[kept++] = obj;
+        } else {
+            delete obj;
+        }
+    }
+    oldGen_.resize(kept);
+}
+
+} // namespace mbl
@@ -0,0 +1,166 @@
+#ifndef MBL_GC_H
+#define MBL_GC_H
+
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+
+#include "list.h"
+#include "object.h"
+#include "value.h"
+
+namespace mbl {
+
+// Generational collection for objects whose lifetime is not an arena
+// scope.  The amortize idiom makes the case: a fresh `period` object per
+// iteration, of which only the ones appended to `periods` survive.  A
+// Heap gives those loops a bump-allocated nursery -- 256 KB by default,
+// sized to stay L2-resident -- and reclaims each dead iteration's
+// garbage with a copying minor collection that touches only the
+// survivors.  Objects that do survive are promoted to the old
+// generation, on the grounds that a survivor here is a retained record,
+// not a temporary that got lucky.
+//
+// The generational invariant (no unscanned old-to-young pointers) is
+// kept by a write barrier on property stores and list appends: storing a
+// nursery object into old-generation storage records the holder in a
+// remembered set, which minor collections scan alongside the explicit
+// roots.  When no Heap is active the barrier is one thread-local load
+// and a branch.
+//
+// Contract: a minor collection MOVES nursery objects.  Anything that
+// must survive one has to be reachable from a registered root range (or
+// from the old generation through the barrier); raw C++ pointers into
+// the nursery are invalid after any allocateObject() call.
+class Heap {
+public:
+    explicit Heap(std::size_t nurseryBytes = 256 * 1024);
+    ~Heap();
+
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+
+    // Bump-allocates one object in the nursery, running a minor
+    // collection first if it is full.  The object's slot array grows in
+    // the nursery too.
+    Object* allocateObject();
+
+    // Nursery space for a growing slot array; returns nullptr when the
+    // nursery cannot fit it, in which case the slots fall back to the
+    // plain heap (growing mid-store is no moment to move objects).
+    Value* allocateSlots(std::uint32_t capacity);
+
+    bool inNursery(const void* p) const {
+        return p >= nursery_ && p < nursery_ + nurserySize_;
+    }
+
+    // Declares [begin, begin+count) as GC roots until removeRootRange.
+    // The VM registers its register file this way while running GC-backed
+    // code.
+    void addRootRange(Value* begin, std::size_t count);
+    void removeRootRange(Value* begin);
+
+    // Write-barrier slow paths; called through the inline wrappers below.
+    void rememberObject(Object* holder);
+    void rememberList(List* holder);
+
+    // Evacuates live nursery objects into the old generation and resets
+    // the bump pointer.  Microseconds for a loop iteration's garbage:
+    // cost tracks survivors, not allocation.
+    void collectMinor();
+
+    // Stop-the-world mark/sweep over the old generation; runs a minor
+    // collection first so the nursery is empty.
+    void collectMajor();
+
+    std::size_t minorCollections() const { return minorCollections_; }
+    std::size_t promotedObjects() const { return promotedObjects_; }
+    std::size_t oldGenerationCount() const { return oldGen_.size(); }
+
+private:
+    void scanValue(Value& v);
+    void scanObjectRef(Object*& obj);
+    void scanList(List* list);
+    Object* promote(Object* obj);
+
+    void markValue(Value v);
+    void markObject(Object* obj);
+
+    char* nursery_;
+    std::size_t nurserySize_;
+    std::size_t bump_ = 0;
+
+    std::vector<std::pair<Value*, std::size_t>> roots_;
+    std::vector<Object*> rememberedObjects_;
+    std::unordered_set<List*> rememberedLists_;
+    std::vector<Object*> oldGen_;
+
+    // Per-collection working state.
+    std::vector<Object*> scanQueue_;
+    std::unordered_set<List*> visitedLists_;
+
+    std::size_t minorCollections_ = 0;
+    std::size_t promotedObjects_ = 0;
+};
+
+// The heap the current thread allocates from, set by GcScope; mirrors
+// currentArena() in arena.h.
+Heap* currentHeap();
+
+class GcScope {
+public:
+    explicit GcScope(Heap& heap);
+    ~GcScope();
+
+    GcScope(const GcScope&) = delete;
+    GcScope& operator=(const GcScope&) = delete;
+
+private:
+    Heap* previous_;
+};
+
+// Registers a root range for the lifetime of the scope.
+class GcRootRange {
+public:
+    GcRootRange(Heap& heap, Value* begin, std::size_t count)
+        : heap_(heap), begin_(begin) {
+        heap_.addRootRange(begin, count);
+    }
+    ~GcRootRange() { heap_.removeRootRange(begin_); }
+
+    GcRootRange(const GcRootRange&) = delete;
+    GcRootRange& operator=(const GcRootRange&) = delete;
+
+private:
+    Heap& heap_;
+    Value* begin_;
+};
+
+// The write barrier, as called from Object::set / setPropCached.  The
+// no-heap case -- all arena and plain-heap programs -- pays one
+// thread-local load and a branch.
+inline void gcWriteBarrier(Object* holder, Value stored) {
+    Heap* heap = currentHeap();
+    if (!heap) return;
+    if (stored.tag != Tag::Obj && stored.tag != Tag::ListVal) return;
+    if (heap->inNursery(holder)) return;  // young-to-young needs no record
+    if (holder->gcRemembered) return;
+    if (stored.tag == Tag::Obj && !heap->inNursery(stored.object)) return;
+    // A stored list is remembered conservatively: it may hold or later
+    // gain nursery references of its own.
+    heap->rememberObject(holder);
+}
+
+// The list counterpart, called from List::append: lists are never in the
+// nursery, so any list that receives a nursery object must be scanned.
+inline void gcListBarrier(List* holder, Value stored) {
+    Heap* heap = currentHeap();
+    if (!heap) return;
+    if (stored.tag == Tag::Obj && heap->inNursery(stored.object)) {
+        heap->rememberList(holder);
+    }
+}
+
+} // namespace mbl
+
+#endif
@@ -0,0 +1,452 @@
+#include "graphfile.h"
+
+#include "error.h"
+#include "list.h"
+#include "object.h"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mbl {
+
+namespace {
+
+constexpr std::uint32_t kMagic = 0x4D424C47;  // "MBLG"
+constexpr std::uint32_t kVersion = 1;
+
+// Value encoding tags inside the file; independent of Tag's numbering so
+// reordering the runtime enum cannot silently corrupt old files.
+enum : std::uint8_t {
+    kMissing, kBool, kInt, kFloat, kMoney, kDate, kInterval, kText, kObj, kList
+};
+
+// Fixed section-record sizes the reader arithmetic depends on.
+constexpr std::size_t kHeaderSize = 24 + 7 * 8;
+constexpr std::size_t kObjectRecordSize = 16;  // shapeId, proto+1, firstValue
+constexpr std::size_t kListRecordSize = 16;    // firstValue, count
+constexpr std::size_t kValueRecordSize = 24;   // tag + pad, a, b
+
+struct Writer {
+    FILE* out;
+    std::uint64_t written = 0;
+
+    void bytes(const void* p, std::size_t n) {
+        if (std::fwrite(p, 1, n, out) != n) throw MblError("Graph file write failed");
+        written += n;
+    }
+    void u8(std::uint8_t v) { bytes(&v, 1); }
+    void u32(std::uint32_t v) { bytes(&v, 4); }
+    void u64(std::uint64_t v) { bytes(&v, 8); }
+    void padTo(std::uint64_t offset) {
+        static const char zeros[8] = {};
+        while (written < offset) {
+            std::size_t n = (std::size_t)(offset - written);
+            bytes(zeros, n < 8 ? n : 8);
+        }
+    }
+};
+
+// Same first-seen-order traversal as the snapshot writer; duplicated here
+// because the two formats index the graph differently (snapshot streams
+// bodies, this one assigns every slot a fixed record number).
+struct GraphIndex {
+    std::unordered_map<const Object*, std::uint32_t> objects;
+    std::unordered_map<const List*, std::uint32_t> lists;
+    std::unordered_map<const std::string*, std::uint64_t> textOffsets;
+    std::vector<const Object*> objectOrder;
+    std::vector<const List*> listOrder;
+    std::vector<const std::string*> textOrder;
+    std::uint64_t textBytes = 0;
+
+    void visitValue(Value v) {
+        if (v.tag == Tag::Obj) visitObject(v.object);
+        else if (v.tag == Tag::ListVal) visitList(v.list);
+        else if (v.tag == Tag::Text && v.text && !textOffsets.count(v.text)) {
+            textOffsets.emplace(v.text, textBytes);
+            textOrder.push_back(v.text);
+            textBytes += v.text->size();
+        }
+    }
+
+    void visitObject(const Object* o) {
+        if (!o || objects.count(o)) return;
+        objects.emplace(o, (std::uint32_t)objectOrder.size());
+        objectOrder.push_back(o);
+        visitObject(o->proto);
+        for (std::uint32_t s = 0; s < o->slots.count; ++s) visitValue(o->slots[s]);
+    }
+
+    void visitList(const List* l) {
+        if (!l || lists.count(l)) return;
+        lists.emplace(l, (std::uint32_t)listOrder.size());
+        listOrder.push_back(l);
+        for (std::size_t i = 0; i < l->size(); ++i) visitValue(l->at(i));
+    }
+};
+
+void writeValueRecord(Writer& w, const GraphIndex& g, Value v) {
+    std::uint8_t tag;
+    std::uint64_t a = 0, b = 0;
+    switch (v.tag) {
+        case Tag::Missing: tag = kMissing; break;
+        case Tag::Boolean: tag = kBool; a = v.boolean ? 1 : 0; break;
+        case Tag::Integer: tag = kInt; a = (std::uint64_t)v.integer; break;
+        case Tag::Float: tag = kFloat; std::memcpy(&a, &v.real, 8); break;
+        case Tag::MoneyVal:
+            tag = kMoney;
+            a = (std::uint64_t)(unsigned __int128)v.money.units;
+            b = (std::uint64_t)((unsigned __int128)v.money.units >> 64);
+            break;
+        case Tag::Date: tag = kDate; a = v.date.packed; break;
+        case Tag::IntervalVal: tag = kInterval; a = v.interval; break;
+        case Tag::Text:
+            tag = kText;
+            a = g.textOffsets.at(v.text);
+            b = v.text->size();
+            break;
+        case Tag::Obj: tag = kObj; a = g.objects.at(v.object); break;
+        case Tag::ListVal: tag = kList; a = g.lists.at(v.list); break;
+        default: throw MblError("Graph file cannot hold this value");
+    }
+    static const char pad[7] = {};
+    w.u8(tag);
+    w.bytes(pad, 7);
+    w.u64(a);
+    w.u64(b);
+}
+
+std::uint64_t alignUp(std::uint64_t n) { return (n + 7) & ~(std::uint64_t)7; }
+
+} // namespace
+
+void GraphFile::write(const std::string& path, Value root) {
+    GraphIndex graph;
+    graph.visitValue(root);
+
+    // Local symbol ids in first-seen order, and the deduplicated shape
+    // table: most objects in a pipeline batch share a handful of shapes,
+    // so the field-name lists are written once each.
+    std::unordered_map<Symbol, std::uint32_t> symbolIds;
+    std::vector<Symbol> symbolOrder;
+    auto localSymbol = [&](Symbol s) {
+        auto it = symbolIds.find(s);
+        if (it != symbolIds.end()) return it->second;
+        std::uint32_t id = (std::uint32_t)symbolOrder.size();
+        symbolIds.emplace(s, id);
+        symbolOrder.push_back(s);
+        return id;
+    };
+
+    std::map<std::vector<std::uint32_t>, std::uint32_t> shapeIds;
+    std::vector<const std::vector<std::uint32_t>*> shapeOrder;
+    std::vector<std::uint32_t> objectShape(graph.objectOrder.size());
+    for (std::size_t i = 0; i < graph.objectOrder.size(); ++i) {
+        std::vector<std::uint32_t> def;
+        for (Symbol s : graph.objectOrder[i]->shape->names()) def.push_back(localSymbol(s));
+        auto it = shapeIds.find(def);
+        if (it == shapeIds.end()) {
+            it = shapeIds.emplace(std::move(def), (std::uint32_t)shapeIds.size()).first;
+        }
+        objectShape[i] = it->second;
+    }
+    shapeOrder.resize(shapeIds.size());
+    for (const auto& entry : shapeIds) shapeOrder[entry.second] = &entry.first;
+
+    // Assign every object slot and list element a fixed 24-byte record in
+    // the value section, plus one trailing record for the root.
+    std::vector<std::uint64_t> objectFirstValue(graph.objectOrder.size());
+    std::vector<std::uint64_t> listFirstValue(graph.listOrder.size());
+    std::uint64_t valueCount = 0;
+    for (std::size_t i = 0; i < graph.objectOrder.size(); ++i) {
+        objectFirstValue[i] = valueCount;
+        valueCount += graph.objectOrder[i]->slots.count;
+    }
+    for (std::size_t i = 0; i < graph.listOrder.size(); ++i) {
+        listFirstValue[i] = valueCount;
+        valueCount += graph.listOrder[i]->size();
+    }
+    std::uint64_t rootRecord = valueCount++;
+
+    // Lay the sections out so the header can carry absolute offsets and
+    // the multi-word records land 8-aligned in the mapping.
+    std::uint64_t symbolsOff = kHeaderSize;
+    std::uint64_t symbolBytes = 0;
+    for (Symbol s : symbolOrder) symbolBytes += 4 + symbolName(s).size();
+    std::uint64_t shapeOffsetsOff = alignUp(symbolsOff + symbolBytes);
+    std::uint64_t shapeDataOff = shapeOffsetsOff + 8 * shapeOrder.size();
+    std::uint64_t shapeBytes = 0;
+    std::vector<std::uint64_t> shapeOffsets(shapeOrder.size());
+    for (std::size_t i = 0; i < shapeOrder.size(); ++i) {
+        shapeOffsets[i] = shapeBytes;
+        shapeBytes += 4 + 4 * shapeOrder[i]->size();
+    }
+    std::uint64_t objectsOff = alignUp(shapeDataOff + shapeBytes);
+    std::uint64_t listsOff = objectsOff + kObjectRecordSize * graph.objectOrder.size();
+    std::uint64_t valuesOff = listsOff + kListRecordSize * graph.listOrder.size();
+    std::uint64_t textOff = valuesOff + kValueRecordSize * valueCount;
+
+    FILE* out = std::fopen(path.c_str(), "wb");
+    if (!out) throw MblError("Cannot create graph file: " + path);
+    Writer w{out};
+    try {
+        w.u32(kMagic);
+        w.u32(kVersion);
+        w.u32((std::uint32_t)symbolOrder.size());
+        w.u32((std::uint32_t)shapeOrder.size());
+        w.u32((std::uint32_t)graph.objectOrder.size());
+        w.u32((std::uint32_t)graph.listOrder.size());
+        w.u64(shapeOffsetsOff);
+        w.u64(objectsOff);
+        w.u64(listsOff);
+        w.u64(valuesOff);
+        w.u64(textOff);
+        w.u64(valueCount);
+        w.u64(rootRecord);
+
+        for (Symbol s : symbolOrder) {
+            const std::string& name = symbolName(s);
+            w.u32((std::uint32_t)name.size());
+            w.bytes(name.data(), name.size());
+        }
+
+        w.padTo(shapeOffsetsOff);
+        for (std::uint64_t off : shapeOffsets) w.u64(off);
+        for (const std::vector<std::uint32_t>* def : shapeOrder) {
+            w.u32((std::uint32_t)def->size());
+            for (std::uint32_t s : *def) w.u32(s);
+        }
+
+        w.padTo(objectsOff);
+        for (std::size_t i = 0; i < graph.objectOrder.size(); ++i) {
+            const Object* o = graph.objectOrder[i];
+            w.u32(objectShape[i]);
+            w.u32(o->proto ? graph.objects.at(o->proto) + 1 : 0);
+            w.u64(objectFirstValue[i]);
+        }
+
+        for (std::size_t i = 0; i < graph.listOrder.size(); ++i) {
+            w.u64(listFirstValue[i]);
+            w.u64(graph.listOrder[i]->size());
+        }
+
+        for (const Object* o : graph.objectOrder) {
+            for (std::uint32_t s = 0; s < o->slots.count; ++s) {
+                writeValueRecord(w, graph, o->slots[s]);
+            }
+        }
+        for (const List* l : graph.listOrder) {
+            for (std::size_t i = 0; i < l->size(); ++i) {
+                writeValueRecord(w, graph, l->at(i));
+            }
+        }
+        writeValueRecord(w, graph, root);
+
+        for (const std::string* t : graph.textOrder) w.bytes(t->data(), t->size());
+    } catch (...) {
+        std::fclose(out);
+        throw;
+    }
+    if (std::fclose(out) != 0) throw MblError("Graph file write failed: " + path);
+}
+
+namespace {
+
+std::uint32_t read32(const char* p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+std::uint64_t read64(const char* p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+
+} // namespace
+
+GraphFile::GraphFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw MblError("Cannot open graph file: " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || (std::size_t)st.st_size < kHeaderSize) {
+        ::close(fd);
+        throw MblError("Graph file is truncated: " + path);
+    }
+    size_ = (std::size_t)st.st_size;
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) throw MblError("Cannot map graph file: " + path);
+    base_ = (const char*)map;
+
+    try {
+        if (read32(base_) != kMagic) throw MblError("Not a graph file: " + path);
+        if (read32(base_ + 4) != kVersion)
+            throw MblError("Graph file is from an incompatible runtime: " + path);
+
+        std::uint32_t symbolCount = read32(base_ + 8);
+        shapeCount_ = read32(base_ + 12);
+        objectCount_ = read32(base_ + 16);
+        listCount_ = read32(base_ + 20);
+        std::uint64_t shapeOffsetsOff = read64(base_ + 24);
+        std::uint64_t objectsOff = read64(base_ + 32);
+        std::uint64_t listsOff = read64(base_ + 40);
+        std::uint64_t valuesOff = read64(base_ + 48);
+        std::uint64_t textOff = read64(base_ + 56);
+        valueCount_ = read64(base_ + 64);
+        rootRecord_ = read64(base_ + 72);
+
+        if (textOff > size_ || valuesOff + kValueRecordSize * valueCount_ > textOff ||
+            listsOff + kListRecordSize * listCount_ > valuesOff ||
+            objectsOff + kObjectRecordSize * objectCount_ > listsOff ||
+            shapeOffsetsOff + 8 * shapeCount_ > objectsOff ||
+            rootRecord_ >= valueCount_) {
+            throw MblError("Graph file is truncated: " + path);
+        }
+
+        shapeOffsets_ = (const std::uint64_t*)(base_ + shapeOffsetsOff);
+        shapeData_ = base_ + shapeOffsetsOff + 8 * shapeCount_;
+        objectRecords_ = base_ + objectsOff;
+        listRecords_ = base_ + listsOff;
+        valueRecords_ = base_ + valuesOff;
+        textBlob_ = base_ + textOff;
+        textBytes_ = size_ - textOff;
+
+        // Interning the writer's symbols once here is the whole "load":
+        // everything past this line is pointer arithmetic over the mapping.
+        symbols_.resize(symbolCount);
+        const char* p = base_ + kHeaderSize;
+        std::string scratch;
+        for (std::uint32_t i = 0; i < symbolCount; ++i) {
+            if (p + 4 > base_ + shapeOffsetsOff) {
+                throw MblError("Graph file is truncated: " + path);
+            }
+            std::uint32_t len = read32(p);
+            p += 4;
+            if (p + len > base_ + shapeOffsetsOff) {
+                throw MblError("Graph file is truncated: " + path);
+            }
+            scratch.assign(p, len);
+            p += len;
+            symbols_[i] = intern(scratch);
+        }
+    } catch (...) {
+        ::munmap((void*)base_, size_);
+        throw;
+    }
+}
+
+GraphFile::~GraphFile() {
+    if (base_) ::munmap((void*)base_, size_);
+}
+
+GraphFile::ViewValue GraphFile::valueAt(std::uint64_t recordIndex) const {
+    if (recordIndex >= valueCount_) throw MblError("Graph file is corrupt");
+    const char* rec = valueRecords_ + kValueRecordSize * recordIndex;
+    std::uint64_t a = read64(rec + 8);
+    std::uint64_t b = read64(rec + 16);
+    switch ((std::uint8_t)rec[0]) {
+        case kMissing: return ViewValue(this, Tag::Missing, 0, 0);
+        case kBool: return ViewValue(this, Tag::Boolean, a, 0);
+        case kInt: return ViewValue(this, Tag::Integer, a, 0);
+        case kFloat: return ViewValue(this, Tag::Float, a, 0);
+        case kMoney: return ViewValue(this, Tag::MoneyVal, a, b);
+        case kDate: return ViewValue(this, Tag::Date, a, 0);
+        case kInterval: return ViewValue(this, Tag::IntervalVal, a, 0);
+        case kText:
+            if (a + b > textBytes_) throw MblError("Graph file is corrupt");
+            return ViewValue(this, Tag::Text, a, b);
+        case kObj:
+            if (a >= objectCount_) throw MblError("Graph file is corrupt");
+            return ViewValue(this, Tag::Obj, a, 0);
+        case kList:
+            if (a >= listCount_) throw MblError("Graph file is corrupt");
+            return ViewValue(this, Tag::ListVal, a, 0);
+    }
+    throw MblError("Graph file is corrupt");
+}
+
+GraphFile::ViewValue GraphFile::root() const {
+    return valueAt(rootRecord_);
+}
+
+double GraphFile::ViewValue::asFloat() const {
+    double d;
+    std::memcpy(&d, &a_, 8);
+    return d;
+}
+
+Money GraphFile::ViewValue::asMoney() const {
+    Money m;
+    m.units = (__int128)(((unsigned __int128)b_ << 64) | a_);
+    return m;
+}
+
+std::string_view GraphFile::ViewValue::asText() const {
+    return std::string_view(file_->textBlob_ + a_, (std::size_t)b_);
+}
+
+GraphFile::ObjectView GraphFile::ViewValue::asObject() const {
+    return ObjectView(file_, (std::uint32_t)a_);
+}
+
+GraphFile::ListView GraphFile::ViewValue::asList() const {
+    return ListView(file_, (std::uint32_t)a_);
+}
+
+GraphFile::ViewValue GraphFile::ObjectView::field(Symbol name) const {
+    // Same walk as Object::get: own shape first, then the prototype chain.
+    const GraphFile* f = file_;
+    std::uint32_t index = index_;
+    for (;;) {
+        const char* rec = f->objectRecords_ + kObjectRecordSize * index;
+        std::uint32_t shapeId = read32(rec);
+        if (shapeId >= f->shapeCount_) throw MblError("Graph file is corrupt");
+        const char* shape = f->shapeData_ + f->shapeOffsets_[shapeId];
+        std::uint32_t fields = read32(shape);
+        for (std::uint32_t i = 0; i < fields; ++i) {
+            std::uint32_t sym = read32(shape + 4 + 4 * i);
+            if (sym < f->symbols_.size() && f->symbols_[sym] == name) {
+                return f->valueAt(read64(rec + 8) + i);
+            }
+        }
+        std::uint32_t protoRef = read32(rec + 4);
+        if (!protoRef) return ViewValue(f, Tag::Missing, 0, 0);
+        index = protoRef - 1;
+        if (index >= f->objectCount_) throw MblError("Graph file is corrupt");
+    }
+}
+
+std::size_t GraphFile::ObjectView::fieldCount() const {
+    const char* rec = file_->objectRecords_ + kObjectRecordSize * index_;
+    return read32(file_->shapeData_ + file_->shapeOffsets_[read32(rec)]);
+}
+
+Symbol GraphFile::ObjectView::fieldName(std::size_t i) const {
+    const char* rec = file_->objectRecords_ + kObjectRecordSize * index_;
+    const char* shape = file_->shapeData_ + file_->shapeOffsets_[read32(rec)];
+    return file_->symbols_.at(read32(shape + 4 + 4 * i));
+}
+
+GraphFile::ViewValue GraphFile::ObjectView::fieldAt(std::size_t i) const {
+    const char* rec = file_->objectRecords_ + kObjectRecordSize * index_;
+    return file_->valueAt(read64(rec + 8) + i);
+}
+
+std::size_t GraphFile::ListView::size() const {
+    return (std::size_t)read64(file_->listRecords_ + kListRecordSize * index_ + 8);
+}
+
+GraphFile::ViewValue GraphFile::ListView::at(std::size_t i) const {
+    const char* rec = file_->listRecords_ + kListRecordSize * index_;
+    if (i >= read64(rec + 8)) throw MblError("List position out of range");
+    return file_->valueAt(read64(rec) + i);
+}
+
+} // namespace mbl
@@ -0,0 +1,140 @@
+#ifndef MBL_GRAPHFILE_H
+#define MBL_GRAPHFILE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "symbol.h"
+#include "value.h"
+
+namespace mbl {
+
+// The binary format MBL object graphs travel in between pipeline stages.
+// Where a snapshot (snapshot.h) rebuilds a live heap, a graph file is
+// built to be READ IN PLACE: the reader mmaps it and navigates object and
+// list views directly over the mapping, so "loading" 10 GB of
+// intermediate state is an mmap and a header check, and only the fields a
+// stage actually touches are ever decoded.
+//
+// Layout: a shape table (field-name lists) shared by all objects, then
+// fixed-size object and list records indexing into a flat array of
+// 24-byte value records, then the text blob.  Money travels as its full
+// 128-bit units, dates as the packed civil word, prototype links as
+// object indexes that field lookup follows exactly like the live chain.
+//
+// Schema evolution is by name, not position: a reader asks an ObjectView
+// for "settlementDate" and gets Missing if the writing stage did not have
+// that field, while fields the reader never heard of simply sit in the
+// file unread.  Renames are the one thing this cannot absorb.
+
+class GraphFile {
+public:
+    // Serializes the graph reachable from `root` (an object, list, or
+    // scalar) to `path`, overwriting it.
+    static void write(const std::string& path, Value root);
+
+    // Maps `path` read-only and validates the header.  Throws MblError on
+    // a missing, truncated or foreign file.
+    explicit GraphFile(const std::string& path);
+    ~GraphFile();
+
+    GraphFile(const GraphFile&) = delete;
+    GraphFile& operator=(const GraphFile&) = delete;
+
+    class ObjectView;
+    class ListView;
+
+    // One decoded-on-demand value inside the mapping.
+    class ViewValue {
+    public:
+        Tag tag() const { return tag_; }
+        bool isMissing() const { return tag_ == Tag::Missing; }
+
+        bool asBool() const { return a_ != 0; }
+        std::int64_t asInt() const { return (std::int64_t)a_; }
+        double asFloat() const;
+        Money asMoney() const;
+        DateTime asDate() const { DateTime d; d.packed = a_; return d; }
+        std::uint64_t asInterval() const { return a_; }
+        // Points into the mapping; valid while the GraphFile is open.
+        std::string_view asText() const;
+        ObjectView asObject() const;
+        ListView asList() const;
+
+    private:
+        friend class GraphFile;
+        ViewValue(const GraphFile* file, Tag tag, std::uint64_t a, std::uint64_t b)
+            : file_(file), tag_(tag), a_(a), b_(b) {}
+        const GraphFile* file_;
+        Tag tag_;
+        std::uint64_t a_, b_;
+    };
+
+    class ObjectView {
+    public:
+        // Field read through the stored prototype chain; Missing when no
+        // link has the field -- the schema-evolution path.
+        ViewValue field(Symbol name) const;
+        ViewValue field(const std::string& name) const { return field(intern(name)); }
+
+        std::size_t fieldCount() const;
+        Symbol fieldName(std::size_t i) const;
+        ViewValue fieldAt(std::size_t i) const;
+
+    private:
+        friend class GraphFile;
+        ObjectView(const GraphFile* file, std::uint32_t index)
+            : file_(file), index_(index) {}
+        const GraphFile* file_;
+        std::uint32_t index_;
+    };
+
+    class ListView {
+    public:
+        std::size_t size() const;
+        ViewValue at(std::size_t i) const;
+
+    private:
+        friend class GraphFile;
+        ListView(const GraphFile* file, std::uint32_t index)
+            : file_(file), index_(index) {}
+        const GraphFile* file_;
+        std::uint32_t index_;
+    };
+
+    ViewValue root() const;
+
+private:
+    friend class ObjectView;
+    friend class ListView;
+    friend class ViewValue;
+
+    const char* base_ = nullptr;
+    std::size_t size_ = 0;
+
+    // Decoded header fields and section pointers.
+    const std::uint64_t* shapeOffsets_ = nullptr;  // relative to shapeData_
+    const char* shapeData_ = nullptr;
+    std::uint32_t shapeCount_ = 0;
+    const char* objectRecords_ = nullptr;
+    const char* listRecords_ = nullptr;
+    const char* valueRecords_ = nullptr;
+    const char* textBlob_ = nullptr;
+    std::uint32_t objectCount_ = 0;
+    std::uint32_t listCount_ = 0;
+    std::uint64_t valueCount_ = 0;
+    std::uint64_t textBytes_ = 0;
+    std::uint64_t rootRecord_ = 0;
+
+    // File symbol id -> interned runtime Symbol, built once at open so
+    // field lookup is integer compares.
+    std::vector<Symbol> symbols_;
+
+    ViewValue valueAt(std::uint64_t recordIndex) const;
+};
+
+} // namespace mbl
+
+#endif
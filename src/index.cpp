@@ -0,0 +1,158 @@
+#include "index.h"
+
+#include "error.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace mbl {
+
+std::size_t ValueKeyHash::operator()(const Value& v) const {
+    switch (v.tag) {
+        case Tag::Integer:
+            return (std::size_t)((std::uint64_t)v.integer * 0x9E3779B97F4A7C15ull);
+        case Tag::Date:
+            return (std::size_t)(v.date.packed * 0x9E3779B97F4A7C15ull);
+        case Tag::MoneyVal: {
+            std::uint64_t lo = (std::uint64_t)v.money.units;
+            std::uint64_t hi = (std::uint64_t)((unsigned __int128)v.money.units >> 64);
+            return (std::size_t)((lo ^ (hi * 0x9E3779B97F4A7C15ull)) * 0xFF51AFD7ED558CCDull);
+        }
+        case Tag::Text:
+            return std::hash<std::string>()(*v.text);
+        default:
+            throw MblError("Index keys must be Integer, Money, Date or Text");
+    }
+}
+
+bool ValueKeyEq::operator()(const Value& a, const Value& b) const {
+    if (a.tag != b.tag) return false;
+    switch (a.tag) {
+        case Tag::Integer: return a.integer == b.integer;
+        case Tag::Date: return a.date == b.date;
+        case Tag::MoneyVal: return a.money == b.money;
+        case Tag::Text: return *a.text == *b.text;
+        default: return false;
+    }
+}
+
+// --- TableIndex -----------------------------------------------------------
+
+TableIndex::TableIndex(Table& table, std::size_t keyCol)
+    : table_(table), keyCol_(keyCol) {
+    if (keyCol >= table.columnCount()) throw MblError("Table column out of range");
+    rebuild();
+    table_.observe(keyCol_, this);
+}
+
+void TableIndex::rebuild() {
+    map_.clear();
+    std::size_t rows = table_.rowCount();
+    map_.reserve(rows);
+    for (std::size_t row = 0; row < rows; ++row) {
+        map_.emplace(table_.at(row, keyCol_), row);
+    }
+}
+
+std::vector<std::size_t> TableIndex::lookup(Value key) const {
+    std::vector<std::size_t> rows;
+    auto range = map_.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) rows.push_back(it->second);
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+std::ptrdiff_t TableIndex::first(Value key) const {
+    auto range = map_.equal_range(key);
+    std::ptrdiff_t best = -1;
+    for (auto it = range.first; it != range.second; ++it) {
+        if (best < 0 || (std::ptrdiff_t)it->second < best) best = (std::ptrdiff_t)it->second;
+    }
+    return best;
+}
+
+void TableIndex::onAppend(std::size_t row, Value v) {
+    map_.emplace(v, row);
+}
+
+void TableIndex::onUpdate(std::size_t row, Value oldValue, Value newValue) {
+    auto range = map_.equal_range(oldValue);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == row) {
+            map_.erase(it);
+            break;
+        }
+    }
+    map_.emplace(newValue, row);
+}
+
+void TableIndex::onBulkWrite() {
+    rebuild();
+}
+
+// --- ListIndex ------------------------------------------------------------
+
+ListIndex::ListIndex(List& list, Symbol keyField)
+    : list_(list), keyField_(keyField) {
+    std::size_t n = list.size();
+    keyAt_.resize(n);
+    map_.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        Value key = keyOf(list.at(i));
+        keyAt_[i] = key;
+        if (!key.isMissing()) map_.emplace(key, i);
+    }
+    list_.attachIndex(this);
+}
+
+ListIndex::~ListIndex() {
+    list_.detachIndex(this);
+}
+
+Value ListIndex::keyOf(Value element) const {
+    if (element.tag != Tag::Obj || !element.object) return Value::missing();
+    return element.object->get(keyField_);
+}
+
+std::vector<std::size_t> ListIndex::lookup(Value key) const {
+    std::vector<std::size_t> positions;
+    auto range = map_.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) positions.push_back(it->second);
+    std::sort(positions.begin(), positions.end());
+    return positions;
+}
+
+Value ListIndex::first(Value key) const {
+    auto range = map_.equal_range(key);
+    std::size_t best = (std::size_t)-1;
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second < best) best = it->second;
+    }
+    return best == (std::size_t)-1 ? Value::missing() : list_.at(best);
+}
+
+void ListIndex::onAppend(std::size_t position, Value v) {
+    Value key = keyOf(v);
+    if (keyAt_.size() <= position) keyAt_.resize(position + 1);
+    keyAt_[position] = key;
+    if (!key.isMissing()) map_.emplace(key, position);
+}
+
+void ListIndex::refresh(std::size_t position) {
+    Value oldKey = position < keyAt_.size() ? keyAt_[position] : Value::missing();
+    if (!oldKey.isMissing()) {
+        auto range = map_.equal_range(oldKey);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == position) {
+                map_.erase(it);
+                break;
+            }
+        }
+    }
+    Value key = keyOf(list_.at(position));
+    if (keyAt_.size() <= position) keyAt_.resize(position + 1);
+    keyAt_[position] = key;
+    if (!key.isMissing()) map_.emplace(key, position);
+}
+
+} // namespace mbl
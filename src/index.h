@@ -0,0 +1,95 @@
+#ifndef MBL_INDEX_H
+#define MBL_INDEX_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "list.h"
+#include "object.h"
+#include "table.h"
+#include "value.h"
+
+namespace mbl {
+
+// Declarable hash indexes, so "find the loan by account number" is one
+// probe instead of a scan over five million elements.  An index is
+// declared once against a collection and maintained incrementally from
+// then on -- O(1) per append and per key write, never rebuilt behind the
+// program's back (a bulk column rewrite is the one exception, and costs
+// one pass).
+//
+// Keys are Integer, Money, Date or Text values; equal keys may map to
+// many positions, so lookups return all of them in insertion order.
+
+// Hashing/equality over key Values; Text compares by contents.
+struct ValueKeyHash {
+    std::size_t operator()(const Value& v) const;
+};
+struct ValueKeyEq {
+    bool operator()(const Value& a, const Value& b) const;
+};
+
+// An index over one column of a Table, registered as an observer so
+// appends and cell writes maintain it automatically.
+class TableIndex : public TableObserver {
+public:
+    // Indexes the rows already present, then stays current.  The index
+    // must not outlive the table.
+    TableIndex(Table& table, std::size_t keyCol);
+
+    // All row numbers whose key equals `key`, in insertion order.
+    std::vector<std::size_t> lookup(Value key) const;
+    // The first matching row, or -1.
+    std::ptrdiff_t first(Value key) const;
+
+    void onAppend(std::size_t row, Value v) override;
+    void onUpdate(std::size_t row, Value oldValue, Value newValue) override;
+    void onBulkWrite() override;
+
+private:
+    void rebuild();
+
+    Table& table_;
+    std::size_t keyCol_;
+    std::unordered_multimap<Value, std::size_t, ValueKeyHash, ValueKeyEq> map_;
+};
+
+// An index over a list of objects, keyed by one property.  Appends to
+// the list maintain it through the list's index hooks; a write to an
+// indexed object's key FIELD cannot be observed from here (objects do
+// not know their indexes), so the compiler emits refresh(position) after
+// any store it cannot prove leaves the key column alone.
+class ListIndex {
+public:
+    // Indexes the objects already in the list, then registers for
+    // appends.  Elements that are not objects, or lack the key property,
+    // are skipped.  The index must not outlive the list.
+    ListIndex(List& list, Symbol keyField);
+    ~ListIndex();
+
+    ListIndex(const ListIndex&) = delete;
+    ListIndex& operator=(const ListIndex&) = delete;
+
+    std::vector<std::size_t> lookup(Value key) const;
+    // The first matching element, or Missing.
+    Value first(Value key) const;
+
+    // Re-keys one element after its key property changed.
+    void refresh(std::size_t position);
+
+    // Called by List::append through the attached-index hook.
+    void onAppend(std::size_t position, Value v);
+
+private:
+    Value keyOf(Value element) const;
+
+    List& list_;
+    Symbol keyField_;
+    std::unordered_multimap<Value, std::size_t, ValueKeyHash, ValueKeyEq> map_;
+    std::vector<Value> keyAt_;  // position -> indexed key, for removal
+};
+
+} // namespace mbl
+
+#endif
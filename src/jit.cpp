@@ -0,0 +1,60 @@
+#include "jit.h"
+
+namespace mbl {
+
+namespace {
+
+inline bool bothAre(const Value* regs, Instruction i, Tag t) {
+    return regs[operandB(i)].tag == t && regs[operandC(i)].tag == t;
+}
+
+} // namespace
+
+void specializeLoop(Chunk& chunk, const Value* regs,
+                    std::size_t loopStart, std::size_t loopEnd) {
+    for (std::size_t at = loopStart; at < loopEnd; ++at) {
+        Instruction i = chunk.code[at];
+        Op specialized;
+        switch (opcode(i)) {
+            case Op::Add:
+                if (bothAre(regs, i, Tag::Integer)) specialized = Op::AddInt;
+                else if (bothAre(regs, i, Tag::MoneyVal)) specialized = Op::AddMoney;
+                else continue;
+                break;
+            case Op::Sub:
+                if (bothAre(regs, i, Tag::Integer)) specialized = Op::SubInt;
+                else if (bothAre(regs, i, Tag::MoneyVal)) specialized = Op::SubMoney;
+                else continue;
+                break;
+            case Op::Mul:
+                if (bothAre(regs, i, Tag::Integer)) specialized = Op::MulInt;
+                else continue;
+                break;
+            case Op::Lt:
+                if (bothAre(regs, i, Tag::Integer)) specialized = Op::LtInt;
+                else if (bothAre(regs, i, Tag::MoneyVal)) specialized = Op::LtMoney;
+                else continue;
+                break;
+            case Op::PercentOf:
+                // The interest shape: integer rate applied to Money.
+                if (regs[operandB(i)].tag == Tag::Integer &&
+                    regs[operandC(i)].tag == Tag::MoneyVal) {
+                    specialized = Op::PercentOfMoney;
+                } else {
+                    continue;
+                }
+                break;
+            case Op::Le:
+                if (bothAre(regs, i, Tag::Integer)) specialized = Op::LeInt;
+                else if (bothAre(regs, i, Tag::MoneyVal)) specialized = Op::LeMoney;
+                else continue;
+                break;
+            default:
+                continue;
+        }
+        chunk.code[at] =
+            encodeABC(specialized, operandA(i), operandB(i), operandC(i));
+    }
+}
+
+} // namespace mbl
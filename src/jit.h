@@ -0,0 +1,34 @@
+#ifndef MBL_JIT_H
+#define MBL_JIT_H
+
+#include <cstddef>
+
+#include "bytecode.h"
+
+namespace mbl {
+
+// The second execution tier.  This runtime stays portable C++, so tier-up
+// is profile-guided bytecode specialization rather than native codegen:
+// when a While loop's backward jump gets hot, the loop body's generic
+// arithmetic and comparison opcodes are rewritten in place to
+// type-specialized forms (AddMoney, LtMoney, AddInt, ...) chosen from the
+// operand tags live in the registers at tier-up time.
+//
+// Each specialized handler begins with a tag guard; if the types it was
+// specialized for stop holding, the handler deoptimizes by rewriting that
+// one site back to its generic opcode and completing the operation through
+// the generic path -- so specialization can never change results, only
+// skip the per-operand dispatch that dominates an interpreted numeric
+// loop.
+
+// Backward-jump executions before a loop tiers up.
+constexpr std::uint16_t kLoopHotThreshold = 64;
+
+// Rewrites eligible opcodes in code[loopStart, loopEnd) based on the tags
+// currently in `regs`.  Called by the VM from a hot backward jump.
+void specializeLoop(Chunk& chunk, const Value* regs,
+                    std::size_t loopStart, std::size_t loopEnd);
+
+} // namespace mbl
+
+#endif
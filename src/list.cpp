@@ -0,0 +1,98 @@
+#include "list.h"
+
+#include "gc.h"
+
+#include "arena.h"
+#include "index.h"
+#include "profile.h"
+
+#include <cstring>
+
+namespace mbl {
+
+List* List::create() {
+    profileNoteAllocation();
+    if (Arena* arena = currentArena()) {
+        // Same reasoning as Object::create: an arena-born list keeps its
+        // chunks and directory in the arena too, so skipping its destructor
+        // at scope rewind frees everything it ever touched.
+        List* list = new (arena->alloc(sizeof(List), alignof(List))) List();
+        list->arenaBacked_ = true;
+        return list;
+    }
+    return new List();
+}
+
+List::~List() {
+    delete indexes_;  // the indexes themselves belong to their declarers
+    if (arenaBacked_) return;
+    for (std::uint32_t i = 0; i < dirCount_; ++i) delete chunks_[i];
+    delete[] chunks_;
+}
+
+List::Chunk* List::newChunk() {
+    if (arenaBacked_) {
+        return new (currentArena()->alloc(sizeof(Chunk), alignof(Chunk))) Chunk();
+    }
+    return new Chunk();
+}
+
+void List::pushChunk(Chunk* c) {
+    if (dirCount_ == dirCapacity_) {
+        std::uint32_t grown = dirCapacity_ ? dirCapacity_ * 2 : 4;
+        Chunk** dir;
+        if (arenaBacked_) {
+            dir = (Chunk**)currentArena()->alloc(grown * sizeof(Chunk*), alignof(Chunk*));
+        } else {
+            dir = new Chunk*[grown];
+        }
+        if (dirCount_) std::memcpy(dir, chunks_, dirCount_ * sizeof(Chunk*));
+        if (!arenaBacked_) delete[] chunks_;
+        chunks_ = dir;
+        dirCapacity_ = grown;
+    }
+    chunks_[dirCount_++] = c;
+}
+
+void List::append(Value v) {
+    gcListBarrier(this, v);
+    std::size_t chunkIndex = count_ / ChunkSize;
+    if (chunkIndex == dirCount_) pushChunk(newChunk());
+    chunks_[chunkIndex]->values[count_ % ChunkSize] = v;
+    ++count_;
+    if (indexes_) {
+        for (ListIndex* index : *indexes_) index->onAppend(count_ - 1, v);
+    }
+}
+
+void List::attachIndex(ListIndex* index) {
+    if (!indexes_) indexes_ = new std::vector<ListIndex*>();
+    indexes_->push_back(index);
+}
+
+void List::detachIndex(ListIndex* index) {
+    if (!indexes_) return;
+    for (std::size_t i = 0; i < indexes_->size(); ++i) {
+        if ((*indexes_)[i] == index) {
+            indexes_->erase(indexes_->begin() + (std::ptrdiff_t)i);
+            break;
+        }
+    }
+    if (indexes_->empty()) {
+        delete indexes_;
+        indexes_ = nullptr;
+    }
+}
+
+void List::reserve(std::size_t expected) {
+    std::size_t wanted = (expected + ChunkSize - 1) / ChunkSize;
+    while (dirCount_ < wanted) pushChunk(newChunk());
+}
+
+void List::resize(std::size_t n) {
+    reserve(n);
+    for (std::size_t i = n; i < count_; ++i) at(i) = Value::missing();
+    count_ = n;
+}
+
+} // namespace mbl
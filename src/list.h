@@ -0,0 +1,95 @@
+#ifndef MBL_LIST_H
+#define MBL_LIST_H
+
+#include <cstdint>
+#include <vector>
+
+#include "value.h"
+
+namespace mbl {
+
+class ListIndex;
+
+// MBL lists (`periods = []`, `Append period To periods`).  Storage is a
+// chunked deque: fixed-size, cache-line-aligned chunks of Values reached
+// through a small directory of chunk pointers.  Append is amortized O(1)
+// and -- the property the batch workloads care about -- growing the list
+// never moves an element that is already stored: only the pointer directory
+// reallocates, and that is one pointer per ~256 elements.
+//
+// Like objects, a list born inside an ArenaScope draws its chunks and
+// directory from the arena and is reclaimed by the scope rewind; otherwise
+// chunks are heap-allocated and freed by the destructor.
+class List {
+public:
+    // 256 Values per chunk: a few KB, several cache lines of useful payload
+    // per directory hop, and small enough that a 360-row schedule wastes
+    // little.
+    static constexpr std::uint32_t ChunkSize = 256;
+
+    static List* create();
+
+    List() = default;
+    ~List();
+    List(const List&) = delete;
+    List& operator=(const List&) = delete;
+
+    std::size_t size() const { return count_; }
+
+    void append(Value v);
+
+    // Hash-index hooks (see index.h).  Attached indexes are notified per
+    // append; the common unindexed list pays one null-pointer check.
+    void attachIndex(ListIndex* index);
+    void detachIndex(ListIndex* index);
+
+    // Capacity hint: pre-allocates chunks so a loop appending `expected`
+    // elements never pauses to grow.
+    void reserve(std::size_t expected);
+
+    // Sets the element count, allocating chunks as needed; new elements are
+    // Missing.  Parallel fills size the output once, then workers write
+    // disjoint ranges through at() with no growth races.
+    void resize(std::size_t n);
+
+    Value& at(std::size_t i) { return chunks_[i / ChunkSize]->values[i % ChunkSize]; }
+    const Value& at(std::size_t i) const {
+        return chunks_[i / ChunkSize]->values[i % ChunkSize];
+    }
+
+    struct Chunk {
+        alignas(64) Value values[ChunkSize];
+    };
+
+    // Chunk-granular access for kernels that want to run a tight loop over
+    // contiguous storage (aggregations, parallel maps).
+    std::size_t chunkCount() const { return dirCount_; }
+    Value* chunkData(std::size_t c) { return chunks_[c]->values; }
+    std::uint32_t chunkFill(std::size_t c) const {
+        std::size_t start = c * ChunkSize;
+        if (start >= count_) return 0;  // reserved but not yet filled
+        std::size_t remain = count_ - start;
+        return remain > ChunkSize ? ChunkSize : (std::uint32_t)remain;
+    }
+
+private:
+    Chunk* newChunk();
+    void pushChunk(Chunk* c);
+
+    // The directory follows the same ownership regime as the chunks (heap
+    // or arena), so an arena list is entirely reclaimed by the scope rewind
+    // with no destructor needed.  Growing the directory copies pointers
+    // only, never elements.
+    Chunk** chunks_ = nullptr;
+    std::uint32_t dirCount_ = 0;
+    std::uint32_t dirCapacity_ = 0;
+    std::size_t count_ = 0;
+    bool arenaBacked_ = false;
+    // Heap-allocated only when an index attaches; lists are many, indexed
+    // lists are few.
+    std::vector<ListIndex*>* indexes_ = nullptr;
+};
+
+} // namespace mbl
+
+#endif
@@ -0,0 +1,210 @@
+#include "money.h"
+#include "error.h"
+
+#include <cctype>
+#include <cstdio>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace mbl {
+
+namespace {
+
+const __int128 kMax = ~(__int128(1) << 127);
+const __int128 kMin = __int128(1) << 127;
+
+[[noreturn]] void overflowError() {
+    throw MblError("Money overflow: result is outside the representable range");
+}
+
+// Adds with overflow detection: overflow happened iff both operands share a
+// sign and the result does not.
+inline __int128 checkedAdd(__int128 a, __int128 b) {
+    __int128 r = a + b;
+    if (((a ^ r) & (b ^ r)) < 0) overflowError();
+    return r;
+}
+
+// value * num / den with a single half-to-even rounding.  num and den are
+// 64-bit (rates, divisors like 100 or perYear), so the intermediate product
+// fits in 192 bits at most; we split the multiply to keep it exact.
+__int128 mulRatioRounded(__int128 value, std::int64_t num, std::int64_t den) {
+    if (den == 0) throw MblError("Money division by zero");
+    bool negative = false;
+    if (value < 0) { value = -value; negative = !negative; }
+    if (num < 0) { num = -num; negative = !negative; }
+    if (den < 0) { den = -den; negative = !negative; }
+
+    // value * num as a 256-bit quantity (hi:lo of 128 bits each), done limb
+    // by limb so nothing is lost before the divide.
+    unsigned __int128 uv = (unsigned __int128)value;
+    unsigned __int128 un = (unsigned __int128)num;
+    unsigned __int128 lowLimb = (uv & 0xFFFFFFFFFFFFFFFFULL) * un;
+    unsigned __int128 highLimb = (uv >> 64) * un;
+    unsigned __int128 lo = lowLimb + (highLimb << 64);
+    unsigned __int128 hi = (highLimb >> 64) + (lo < lowLimb ? 1 : 0);
+    unsigned __int128 ud = (unsigned __int128)den;
+    if (hi >= ud) overflowError();
+
+    // Schoolbook 256/128 division, one bit at a time over the high part.
+    // den is 64-bit so this loop is short in the common all-64-bit case;
+    // correctness matters more than speed here -- the batch kernels call
+    // this once per value with no allocation.
+    unsigned __int128 quotient = 0;
+    unsigned __int128 remainder = hi;
+    for (int bit = 127; bit >= 0; --bit) {
+        remainder = (remainder << 1) | ((lo >> bit) & 1);
+        quotient <<= 1;
+        if (remainder >= ud) { remainder -= ud; quotient |= 1; }
+    }
+
+    // Half-to-even on the remainder.
+    unsigned __int128 twice = remainder << 1;
+    if (twice > ud || (twice == ud && (quotient & 1))) quotient += 1;
+
+    if (quotient > (unsigned __int128)kMax) overflowError();
+    __int128 result = (__int128)quotient;
+    return negative ? -result : result;
+}
+
+} // namespace
+
+Money Money::fromMajor(std::int64_t whole) {
+    return Money((__int128)whole * Scale);
+}
+
+Money Money::fromString(const std::string& text) {
+    const char* p = text.c_str();
+    bool negative = false;
+    if (*p == '+' || *p == '-') negative = (*p++ == '-');
+    if (!std::isdigit((unsigned char)*p) && *p != '.')
+        throw MblError("Money value is not numeric: \"" + text + "\"");
+
+    __int128 whole = 0;
+    while (std::isdigit((unsigned char)*p)) {
+        whole = checkedAdd(whole * 10, *p++ - '0');
+    }
+    __int128 frac = 0;
+    int fracDigits = 0;
+    if (*p == '.') {
+        ++p;
+        while (std::isdigit((unsigned char)*p)) {
+            if (++fracDigits > 9)
+                throw MblError("Money supports at most nine fractional digits: \"" + text + "\"");
+            frac = frac * 10 + (*p++ - '0');
+        }
+    }
+    if (*p != '\0')
+        throw MblError("Money value is not numeric: \"" + text + "\"");
+    for (; fracDigits < 9; ++fracDigits) frac *= 10;
+
+    __int128 units = checkedAdd(whole * Scale, frac);
+    return Money(negative ? -units : units);
+}
+
+std::string Money::toString() const {
+    unsigned __int128 magnitude =
+        units < 0 ? (unsigned __int128)(-units) : (unsigned __int128)units;
+    unsigned __int128 whole = magnitude / Scale;
+    std::uint64_t frac = (std::uint64_t)(magnitude % Scale);
+
+    std::string digits;
+    do {
+        digits.insert(digits.begin(), char('0' + (int)(whole % 10)));
+        whole /= 10;
+    } while (whole != 0);
+
+    std::string out;
+    if (units < 0) out += '-';
+    out += digits;
+    if (frac != 0) {
+        char buf[11];
+        std::snprintf(buf, sizeof buf, ".%09llu", (unsigned long long)frac);
+        std::string fracText(buf);
+        while (fracText.back() == '0') fracText.pop_back();
+        out += fracText;
+    }
+    return out;
+}
+
+Money Money::operator+(Money other) const { return Money(checkedAdd(units, other.units)); }
+Money Money::operator-(Money other) const { return Money(checkedAdd(units, -other.units)); }
+
+Money Money::mulRatio(std::int64_t num, std::int64_t den) const {
+    return Money(mulRatioRounded(units, num, den));
+}
+
+#if defined(__AVX2__)
+namespace {
+
+// Vectorized 128-bit add over two Money values per iteration.  A Money is
+// two 64-bit limbs in memory (low, high); a 256-bit register holds two of
+// them as [lo0, hi0, lo1, hi1].  Low limbs add with carry detected by an
+// unsigned compare (biased, since AVX2 only has signed 64-bit compares),
+// the carry is shifted into the high lanes and added there.  Overflow of
+// the full 128-bit sums is checked with the same sign rule as checkedAdd.
+inline bool avx2AddPair(Money* out, const Money* a, const Money* b) {
+    __m256i va = _mm256_loadu_si256((const __m256i*)a);
+    __m256i vb = _mm256_loadu_si256((const __m256i*)b);
+    __m256i sum = _mm256_add_epi64(va, vb);
+
+    // carry[lane] = (unsigned)sum < (unsigned)a, valid for the low lanes.
+    __m256i bias = _mm256_set1_epi64x((long long)0x8000000000000000ULL);
+    __m256i carry = _mm256_cmpgt_epi64(_mm256_xor_si256(va, bias),
+                                       _mm256_xor_si256(sum, bias));
+    // Move each low lane's carry mask (-1 or 0) up to its high lane and
+    // subtract, which adds one where a carry happened.
+    __m256i carryHi = _mm256_and_si256(
+        _mm256_shuffle_epi32(carry, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_set_epi64x(-1, 0, -1, 0));
+    sum = _mm256_sub_epi64(sum, carryHi);
+
+    // 128-bit signed overflow test on the high limbs: (a^r) & (b^r) < 0.
+    __m256i ovf = _mm256_and_si256(_mm256_xor_si256(va, sum),
+                                   _mm256_xor_si256(vb, sum));
+    __m256i highMask = _mm256_set_epi64x(-1, 0, -1, 0);
+    if (!_mm256_testz_si256(ovf, highMask)) return false;
+
+    _mm256_storeu_si256((__m256i*)out, sum);
+    return true;
+}
+
+} // namespace
+#endif
+
+void batchAdd(Money* out, const Money* a, const Money* b, std::size_t n) {
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 2 <= n; i += 2) {
+        if (!avx2AddPair(out + i, a + i, b + i)) break;  // rare: recheck scalar
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+Money batchSum(const Money* values, std::size_t n) {
+    // Two independent accumulators hide the add latency; the final fold and
+    // every step stay overflow-checked because a ledger total that wraps is
+    // worse than one that aborts.
+    __int128 even = 0, odd = 0;
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        even = checkedAdd(even, values[i].units);
+        odd = checkedAdd(odd, values[i + 1].units);
+    }
+    if (i < n) even = checkedAdd(even, values[i].units);
+    return Money(checkedAdd(even, odd));
+}
+
+void batchMulRatio(Money* out, const Money* values, std::size_t n,
+                   std::int64_t num, std::int64_t den) {
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = Money(mulRatioRounded(values[i].units, num, den));
+    }
+}
+
+} // namespace mbl
@@ -0,0 +1,73 @@
+#ifndef MBL_MONEY_H
+#define MBL_MONEY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace mbl {
+
+// MBL's Money type.  A Money is a 128-bit signed integer counting
+// billionths of the major currency unit (nine fractional digits), so a
+// value is exact over a far wider range than the two-digit SQL Server
+// Money the README complains about, and arithmetic never drifts the way
+// binary floating point does.
+//
+// Money is a trivially copyable 16-byte value: arrays of Money are flat
+// memory, and the batch kernels below run over them without touching the
+// heap.  Scalar operations round half-to-even and throw MblError on
+// overflow rather than wrapping silently -- this is ledger data.
+struct Money {
+    __int128 units;  // value * Scale
+
+    static constexpr std::int64_t Scale = 1000000000LL;  // 10^9
+
+    Money() : units(0) {}
+    explicit Money(__int128 rawUnits) : units(rawUnits) {}
+
+    static Money fromMajor(std::int64_t whole);
+    // Parses "1234.56", "-0.005", etc.  Throws MblError on malformed input
+    // or more than nine fractional digits.
+    static Money fromString(const std::string& text);
+    std::string toString() const;
+
+    Money operator+(Money other) const;
+    Money operator-(Money other) const;
+    Money operator-() const { return Money(-units); }
+
+    // Multiplies by the rational num/den with one half-to-even rounding at
+    // the end.  This is the primitive behind the percent and Of operators:
+    // interest% Of amount is mulRatio(amount, interest, 100).
+    Money mulRatio(std::int64_t num, std::int64_t den) const;
+
+    bool operator==(Money other) const { return units == other.units; }
+    bool operator!=(Money other) const { return units != other.units; }
+    bool operator<(Money other) const { return units < other.units; }
+    bool operator<=(Money other) const { return units <= other.units; }
+    bool operator>(Money other) const { return units > other.units; }
+    bool operator>=(Money other) const { return units >= other.units; }
+};
+
+static_assert(sizeof(Money) == 16, "Money must stay a flat 16-byte value");
+
+// Batch kernels.  These are the workhorses for ledger-scale jobs: tight
+// loops over contiguous Money arrays, no allocation, no per-value dispatch.
+// When the runtime is built with AVX2 (see MBL_NATIVE in CMakeLists.txt)
+// batchAdd takes a vectorized path for values whose magnitude fits in 64
+// bits -- which in practice is every ledger row -- and falls back to the
+// checked scalar loop otherwise.
+
+// out[i] = a[i] + b[i].  Throws MblError on overflow.
+void batchAdd(Money* out, const Money* a, const Money* b, std::size_t n);
+
+// Returns the exact sum of values[0..n).  Throws MblError on overflow.
+Money batchSum(const Money* values, std::size_t n);
+
+// out[i] = values[i] * num / den, each rounded half-to-even once.
+// This applies an interest rate across a whole column in one pass.
+void batchMulRatio(Money* out, const Money* values, std::size_t n,
+                   std::int64_t num, std::int64_t den);
+
+} // namespace mbl
+
+#endif
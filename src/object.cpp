@@ -0,0 +1,238 @@
+#include "object.h"
+
+#include "arena.h"
+#include "gc.h"
+#include "profile.h"
+
+#include <cstring>
+
+namespace mbl {
+
+void SlotArray::push(Value v) {
+    if (count == capacity) {
+        std::uint32_t newCapacity = capacity ? capacity * 2 : 4;
+        bool freeOld = !arenaBacked && !gcBacked;  // before any fallback flips gcBacked
+        Value* grown = nullptr;
+        if (arenaBacked) {
+            grown = (Value*)currentArena()->alloc(newCapacity * sizeof(Value), alignof(Value));
+        } else if (gcBacked) {
+            // Nursery grow: the abandoned run is reclaimed by the next
+            // minor collection.  A full nursery falls back to the heap --
+            // moving objects mid-store is not an option.
+            Heap* heap = currentHeap();
+            grown = heap ? heap->allocateSlots(newCapacity) : nullptr;
+            if (!grown) {
+                grown = new Value[newCapacity];
+                gcBacked = false;
+            }
+        } else {
+            grown = new Value[newCapacity];
+        }
+        if (count) std::memcpy(grown, data, count * sizeof(Value));
+        if (freeOld && capacity) delete[] data;
+        data = grown;
+        capacity = newCapacity;
+    }
+    data[count++] = v;
+}
+
+Object* Object::create() {
+    profileNoteAllocation();
+    if (Arena* arena = currentArena()) {
+        // Placement-new rather than Arena::create: Object's destructor only
+        // exists to free heap-backed slot arrays, which an arena-born object
+        // never has, so skipping destruction is safe here.
+        Object* obj = new (arena->alloc(sizeof(Object), alignof(Object))) Object();
+        obj->slots.arenaBacked = true;
+        return obj;
+    }
+    // An arena scope wins when both are open: it is the more local choice,
+    // and its objects must not outlive it anyway.
+    if (Heap* heap = currentHeap()) return heap->allocateObject();
+    return new Object();
+}
+
+std::uint32_t protoEpoch = 0;
+
+Shape* Shape::root() {
+    static Shape rootShape;
+    return &rootShape;
+}
+
+Shape* Shape::childWith(Symbol name) {
+    auto it = transitions_.find(name);
+    if (it != transitions_.end()) return it->second;
+
+    Shape* child = new Shape();  // shapes live for the process
+    child->slots_ = slots_;
+    child->slots_[name] = slotCount_;
+    child->slotCount_ = slotCount_ + 1;
+    transitions_[name] = child;
+    return child;
+}
+
+std::vector<Symbol> Shape::names() const {
+    std::vector<Symbol> out(slotCount_);
+    for (const auto& entry : slots_) out[entry.second] = entry.first;
+    return out;
+}
+
+Value Object::get(Symbol name) const {
+    for (const Object* link = this; link; link = link->proto) {
+        int slot = link->shape->find(name);
+        if (slot >= 0) return link->slots[slot];
+    }
+    return Value::missing();
+}
+
+void Object::set(Symbol name, Value v) {
+    gcWriteBarrier(this, v);
+    int slot = shape->find(name);
+    if (slot >= 0) {
+        slots[slot] = v;
+        return;
+    }
+    if (isPrototype) ++protoEpoch;  // a new property may shadow inherited reads
+    shape = shape->childWith(name);
+    slots.push(v);
+}
+
+void Object::setProto(Object* p) {
+    proto = p;
+    for (Object* link = p; link; link = link->proto) link->isPrototype = true;
+}
+
+namespace {
+
+// Past this depth a clone is flattened rather than chained; keeps lookup
+// cost constant when `new` runs inside a long loop.
+constexpr std::uint16_t kMaxCowDepth = 8;
+
+void flattenInto(Object* out, const Object* chain) {
+    for (const Object* link = chain; link; link = link->proto) {
+        for (Symbol name : link->shape->names()) {
+            if (out->shape->find(name) < 0) out->set(name, link->get(name));
+        }
+    }
+}
+
+} // namespace
+
+Object* cloneCow(Object* source) {
+    // Freeze the source's current own slots into a snapshot holder and
+    // demote the source to a child of it.  Moving the slot array is O(1);
+    // the holder is never written again, so sharing it is safe.
+    if (source->slots.count != 0) {
+        Object* snapshot = Object::create();
+        snapshot->shape = source->shape;
+        snapshot->slots = source->slots;
+        snapshot->cowDepth = source->cowDepth;
+        snapshot->proto = source->proto;
+        snapshot->isPrototype = true;
+
+        source->slots.data = nullptr;  // ownership moved to the snapshot
+        source->slots.count = 0;
+        source->slots.capacity = 0;
+        source->shape = Shape::root();
+        source->setProto(snapshot);
+        source->cowDepth = snapshot->cowDepth + 1;
+    }
+
+    Object* clone = Object::create();
+    if (source->cowDepth >= kMaxCowDepth) {
+        flattenInto(clone, source->proto);
+        return clone;
+    }
+    if (source->proto) clone->setProto(source->proto);
+    clone->cowDepth = source->cowDepth;
+    return clone;
+}
+
+namespace {
+
+// Probes the cache; returns the way that matches the receiver or nullptr.
+inline PropCache::Way* probe(PropCache& cache, const Object* obj) {
+    for (int w = 0; w < cache.filled; ++w) {
+        PropCache::Way& way = cache.ways[w];
+        if (way.receiverShape != obj->shape) continue;
+        if (way.holder) {
+            // Prototype-chain hit: holder must still look the same and no
+            // prototype anywhere may have grown a property since fill time.
+            if (way.holderShape != way.holder->shape || way.epoch != protoEpoch) continue;
+        }
+        return &way;
+    }
+    return nullptr;
+}
+
+inline PropCache::Way* claimWay(PropCache& cache) {
+    if (cache.filled < PropCache::Ways) return &cache.ways[cache.filled++];
+    // Megamorphic site: recycle way 0 rather than growing without bound.
+    return &cache.ways[0];
+}
+
+} // namespace
+
+Value getPropCached(Object* obj, PropAccess& site) {
+    if (PropCache::Way* way = probe(site.cache, obj)) {
+        const Object* holder = way->holder ? way->holder : obj;
+        return holder->slots[way->slot];
+    }
+
+    // Slow path: full chain walk, then remember where the property lived.
+    for (Object* link = obj; link; link = link->proto) {
+        int slot = link->shape->find(site.name);
+        if (slot < 0) continue;
+        PropCache::Way* way = claimWay(site.cache);
+        way->receiverShape = obj->shape;
+        way->holder = (link == obj) ? nullptr : link;
+        way->holderShape = link->shape;
+        way->slot = (std::uint32_t)slot;
+        way->epoch = protoEpoch;
+        way->transition = nullptr;
+        return link->slots[slot];
+    }
+    return Value::missing();
+}
+
+void setPropCached(Object* obj, PropAccess& site, Value v) {
+    gcWriteBarrier(obj, v);
+    // Fast paths: a cached own slot, or a cached shape transition for the
+    // "first write of this property on this shape" case the amortize loop's
+    // object literals hit every iteration.
+    for (int w = 0; w < site.cache.filled; ++w) {
+        PropCache::Way& way = site.cache.ways[w];
+        if (way.receiverShape != obj->shape) continue;
+        if (way.transition) {
+            // Same rule as Object::set: a prototype growing a property may
+            // shadow inherited reads cached further down the chain.
+            if (obj->isPrototype) ++protoEpoch;
+            obj->shape = way.transition;
+            obj->slots.push(v);
+            return;
+        }
+        if (!way.holder) {
+            obj->slots[way.slot] = v;
+            return;
+        }
+    }
+
+    Shape* before = obj->shape;
+    int existing = before->find(site.name);
+    obj->set(site.name, v);
+
+    PropCache::Way* way = claimWay(site.cache);
+    way->receiverShape = before;
+    way->holder = nullptr;
+    way->holderShape = nullptr;
+    way->epoch = protoEpoch;
+    if (existing >= 0) {
+        way->slot = (std::uint32_t)existing;
+        way->transition = nullptr;
+    } else {
+        way->slot = obj->shape->slotCount() - 1;
+        way->transition = obj->shape;
+    }
+}
+
+} // namespace mbl
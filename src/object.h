@@ -0,0 +1,161 @@
+#ifndef MBL_OBJECT_H
+#define MBL_OBJECT_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "constraint.h"
+#include "symbol.h"
+#include "value.h"
+
+namespace mbl {
+
+// Hidden classes for MBL objects.  Every object that acquires the same
+// properties in the same order shares one Shape, so "which slot holds
+// principalBalance" is a property of the shape, not of the object, and an
+// inline cache can answer it with a single pointer compare.
+//
+// Shapes form a transition tree from a shared empty root: adding property
+// N to an object with shape S moves it to the unique child shape S+N,
+// created on first use and shared ever after.  Shapes are immutable once
+// created and live for the process -- a program has few shapes and many
+// objects.
+//
+// Property keys are interned Symbols (see symbol.h): MBL's case
+// insensitivity is handled once at intern time, and every lookup below is
+// integer hashing and integer compares.
+class Shape {
+public:
+    static Shape* root();
+
+    // The unique shape reached by adding `name` to this shape.
+    Shape* childWith(Symbol name);
+
+    // Slot index of `name`, or -1 if this shape has no such property.
+    int find(Symbol name) const {
+        auto it = slots_.find(name);
+        return it == slots_.end() ? -1 : (int)it->second;
+    }
+
+    std::uint32_t slotCount() const { return slotCount_; }
+
+    // Property symbols in slot order, for iteration and printing.
+    std::vector<Symbol> names() const;
+
+private:
+    Shape() = default;
+
+    std::unordered_map<Symbol, std::uint32_t> slots_;
+    std::unordered_map<Symbol, Shape*> transitions_;
+    std::uint32_t slotCount_ = 0;
+};
+
+// Flat growable slot storage for one object.  Lives on the plain heap or,
+// when the object was born inside an ArenaScope, in the arena -- in which
+// case grow() copies into fresh arena space and abandons the old run (bump
+// arenas reclaim it wholesale at scope exit, so nothing leaks).
+struct SlotArray {
+    Value* data = nullptr;
+    std::uint32_t count = 0;
+    std::uint32_t capacity = 0;
+    bool arenaBacked = false;
+    bool gcBacked = false;  // lives in a Heap nursery, see gc.h
+
+    ~SlotArray() {
+        if (!arenaBacked && !gcBacked) delete[] data;
+    }
+    Value& operator[](std::size_t i) { return data[i]; }
+    const Value& operator[](std::size_t i) const { return data[i]; }
+    void push(Value v);
+};
+
+// An MBL object: a shape, a flat slot array, and a prototype link.  The
+// README's cascading prototypes mean a property read falls through to the
+// prototype chain when the object has no own slot.
+//
+// Allocate through create(): inside an ArenaScope the object and its slots
+// are bump-allocated and freed by the scope's rewind, otherwise they come
+// from the plain heap.
+struct Object {
+    Shape* shape;
+    SlotArray slots;
+    Object* proto = nullptr;
+    bool isPrototype = false;  // set once something inherits from this object
+    bool gcRemembered = false;  // in the GC remembered set, see gc.h
+    bool gcMarked = false;      // major-collection mark bit
+    std::uint16_t cowDepth = 0;  // snapshot-chain depth, see cloneCow()
+
+    Object() : shape(Shape::root()) {}
+
+    static Object* create();
+
+    // Read through the prototype chain; Missing if no link has the property.
+    Value get(Symbol name) const;
+    Value get(const std::string& name) const { return get(intern(name)); }
+
+    // Write an own property, transitioning the shape if it is new.
+    void set(Symbol name, Value v);
+    void set(const std::string& name, Value v) { set(intern(name), v); }
+
+    void setProto(Object* p);
+};
+
+// `new <object>`: a copy-on-write clone.  Instead of deep-copying, the
+// source's own slots move into a frozen snapshot holder and both the source
+// and the new object become children of it -- an O(1) operation after which
+// each side materializes only the fields it actually writes.  Later writes
+// to the source are therefore invisible to the clone (true copy semantics,
+// not prototype sharing).
+//
+// The amortize idiom `period = new period` grows a snapshot chain one link
+// per iteration; hot fields rewritten every iteration stay in the first
+// link, and once the chain passes a depth bound the clone is flattened into
+// a self-contained object so lookups never degrade past a constant.
+Object* cloneCow(Object* source);
+
+// Bumped whenever an object already in use as a prototype gains a new
+// property.  Inline caches that resolved a read through the prototype chain
+// record the epoch at fill time and miss when it moves, so a shadowing
+// write further down the chain can never be served a stale slot.  Writes to
+// ordinary (non-prototype) objects leave the epoch alone.
+extern std::uint32_t protoEpoch;
+
+// A polymorphic inline cache for one property-access site.  Up to four ways;
+// each way pins the receiver's shape and, for reads that resolved through
+// the prototype chain, the holder object and its shape plus the epoch.
+struct PropCache {
+    static constexpr int Ways = 4;
+    struct Way {
+        const Shape* receiverShape = nullptr;
+        Object* holder = nullptr;          // nullptr: property is an own slot
+        const Shape* holderShape = nullptr;
+        std::uint32_t slot = 0;
+        std::uint32_t epoch = 0;
+        Shape* transition = nullptr;       // set-site only: shape after adding
+    };
+    Way ways[Ways];
+    std::uint8_t filled = 0;
+};
+
+// One property-access site in compiled code: the interned name plus its
+// cache.  GetProp/SetProp instructions carry an index into the chunk's
+// table of these.
+struct PropAccess {
+    Symbol name;
+    PropCache cache;
+    // Compiled constraint guards for set sites (see constraint.h); empty
+    // for unconstrained fields and for sites the compiler proved safe.
+    std::vector<Guard> guards;
+};
+
+// The slow paths behind the VM's GetProp/SetProp handlers.  They do the
+// full lookup, then fill a cache way so the next execution of the same site
+// hits the fast path.
+Value getPropCached(Object* obj, PropAccess& site);
+void setPropCached(Object* obj, PropAccess& site, Value v);
+
+} // namespace mbl
+
+#endif
@@ -0,0 +1,157 @@
+#include "output.h"
+
+#include "error.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include <unistd.h>
+
+namespace mbl {
+
+struct OutputSink::Impl {
+    int fd;
+    char* ring;
+    std::size_t capacity;      // power of two
+    std::size_t head = 0;      // total bytes queued (producer side)
+    std::size_t tail = 0;      // total bytes drained (consumer side)
+    std::size_t written = 0;   // drained and past write()
+    bool shutdown = false;
+    bool ioError = false;
+
+    std::mutex lock;
+    std::condition_variable spaceAvail;
+    std::condition_variable dataAvail;
+    std::condition_variable drained;
+    std::thread flusher;
+
+    std::size_t mask(std::size_t n) const { return n & (capacity - 1); }
+
+    void enqueue(std::string_view data, bool newline) {
+        std::size_t total = data.size() + (newline ? 1 : 0);
+        std::unique_lock<std::mutex> hold(lock);
+        spaceAvail.wait(hold, [&] {
+            return capacity - (head - tail) >= total || ioError;
+        });
+        if (ioError) throw MblError("Output sink write failed");
+
+        std::size_t at = head;
+        std::size_t begin = mask(at);
+        std::size_t firstRun = capacity - begin < data.size() ? capacity - begin : data.size();
+        std::memcpy(ring + begin, data.data(), firstRun);
+        std::memcpy(ring, data.data() + firstRun, data.size() - firstRun);
+        if (newline) ring[mask(at + data.size())] = '\n';
+        head = at + total;
+        dataAvail.notify_one();
+    }
+
+    void flusherLoop() {
+        std::unique_lock<std::mutex> hold(lock);
+        for (;;) {
+            dataAvail.wait(hold, [&] { return head != tail || shutdown; });
+            if (head == tail && shutdown) return;
+
+            // Drain the largest contiguous region, then write without the
+            // lock so producers keep filling behind us.
+            std::size_t begin = mask(tail);
+            std::size_t avail = head - tail;
+            std::size_t run = capacity - begin < avail ? capacity - begin : avail;
+            hold.unlock();
+
+            std::size_t done = 0;
+            bool failed = false;
+            while (done < run) {
+                ssize_t got = ::write(fd, ring + begin + done, run - done);
+                if (got < 0) { failed = true; break; }
+                done += (std::size_t)got;
+            }
+
+            hold.lock();
+            tail += done;
+            written += done;
+            if (failed) ioError = true;
+            spaceAvail.notify_all();
+            drained.notify_all();
+        }
+    }
+};
+
+OutputSink::OutputSink(int fd, std::size_t bufferSize) : impl_(new Impl()) {
+    std::size_t cap = 4096;
+    while (cap < bufferSize) cap *= 2;
+    impl_->fd = fd;
+    impl_->capacity = cap;
+    impl_->ring = new char[cap];
+    impl_->flusher = std::thread([this] { impl_->flusherLoop(); });
+}
+
+OutputSink::~OutputSink() {
+    {
+        std::lock_guard<std::mutex> hold(impl_->lock);
+        impl_->shutdown = true;
+    }
+    impl_->dataAvail.notify_all();
+    impl_->flusher.join();
+    ::close(impl_->fd);
+    delete[] impl_->ring;
+    delete impl_;
+}
+
+void OutputSink::write(std::string_view data) {
+    Impl& s = *impl_;
+    if (data.size() > s.capacity) {
+        // Larger than the ring: split into ring-sized pieces; each piece is
+        // still ordered, we only lose single-call atomicity at this size.
+        while (!data.empty()) {
+            std::size_t piece = data.size() < s.capacity ? data.size() : s.capacity;
+            write(data.substr(0, piece));
+            data.remove_prefix(piece);
+        }
+        return;
+    }
+
+    s.enqueue(data, false);
+}
+
+void OutputSink::writeLine(std::string_view line) {
+    Impl& s = *impl_;
+    if (line.size() + 1 > s.capacity) {
+        // Larger than the ring (counting the newline): enqueue() could never
+        // find room and would wait forever.  Drain the excess through
+        // write()'s splitting path and keep the newline with the tail piece.
+        std::size_t excess = line.size() + 1 - s.capacity;
+        write(line.substr(0, excess));
+        line.remove_prefix(excess);
+    }
+    // Queued in one locked section so the newline cannot separate from its
+    // line under concurrent writers, and no temporary string is built.
+    s.enqueue(line, true);
+}
+
+void OutputSink::flush() {
+    Impl& s = *impl_;
+    std::unique_lock<std::mutex> hold(s.lock);
+    std::size_t target = s.head;
+    s.drained.wait(hold, [&] { return s.written >= target || s.ioError; });
+    if (s.ioError) throw MblError("Output sink write failed");
+}
+
+std::size_t OutputSink::bytesWritten() const {
+    std::lock_guard<std::mutex> hold(impl_->lock);
+    return impl_->written;
+}
+
+OutputSink& OutputSink::toStdout() {
+    static OutputSink sink(::dup(STDOUT_FILENO));
+    return sink;
+}
+
+OutputSink& OutputSink::toStderr() {
+    // Smaller ring: stderr is for diagnostics, latency beats batching.
+    static OutputSink sink(::dup(STDERR_FILENO), 4096);
+    return sink;
+}
+
+} // namespace mbl
@@ -0,0 +1,52 @@
+#ifndef MBL_OUTPUT_H
+#define MBL_OUTPUT_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace mbl {
+
+// The machinery behind `Output ... To <sink>`.  Each sink owns a byte ring
+// buffer and a background flusher thread: Output statements memcpy into the
+// ring and return, the flusher drains full regions with large write()s, and
+// one syscall covers thousands of lines.  An explicit `Flush <sink>`
+// statement maps to flush(), which blocks until everything written so far
+// has reached the file descriptor -- that is the ordering point for jobs
+// that interleave MBL output with external steps.
+//
+// Writers may be on any thread (parallel Tools log too); writes are
+// atomic per call, so lines never interleave mid-line.  If the ring fills
+// (sink slower than producers) the writer blocks rather than dropping or
+// buffering without bound.
+class OutputSink {
+public:
+    // Takes ownership of fd.  bufferSize is rounded up to a power of two.
+    explicit OutputSink(int fd, std::size_t bufferSize = 1 << 20);
+    ~OutputSink();  // flushes, then closes
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    // Queues bytes exactly as given.
+    void write(std::string_view data);
+    // Queues data plus a newline: the Output statement's shape.
+    void writeLine(std::string_view line);
+
+    // Blocks until every byte queued before the call has been written out.
+    void flush();
+
+    std::size_t bytesWritten() const;  // drained to the fd so far
+
+    // Process-wide sinks for the standard streams (do not close stdout).
+    static OutputSink& toStdout();
+    static OutputSink& toStderr();
+
+private:
+    struct Impl;
+    Impl* impl_;
+};
+
+} // namespace mbl
+
+#endif
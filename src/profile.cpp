@@ -0,0 +1,183 @@
+#include "profile.h"
+
+#include "error.h"
+#include "object.h"
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace mbl {
+
+namespace {
+
+// Site names live in fixed static storage so the signal-handler dump can
+// read them without touching the allocator or any lock.
+constexpr std::size_t kNameBytes = 64;
+
+struct SiteInfo {
+    char name[kNameBytes];
+    ProfileKind kind;
+};
+
+SiteInfo siteInfo[kMaxProfileSites];
+std::atomic<std::uint32_t> siteCount{0};
+
+// Per-thread buffers chained into a lock-free list the readers walk.  A
+// buffer is never unlinked: a finished worker's counts stay in the
+// totals, and the dump path never races a free.
+struct Buffer {
+    ProfileCounters counters[kMaxProfileSites];
+    Buffer* next = nullptr;
+};
+
+std::atomic<Buffer*> buffers{nullptr};
+thread_local Buffer* myBuffer = nullptr;
+
+std::mutex registerMutex;
+
+Buffer& threadBuffer() {
+    if (!myBuffer) {
+        Buffer* b = new Buffer();
+        b->next = buffers.load(std::memory_order_relaxed);
+        while (!buffers.compare_exchange_weak(b->next, b, std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+        }
+        myBuffer = b;
+    }
+    return *myBuffer;
+}
+
+struct Totals {
+    std::uint64_t invocations, cycles, loopTrips, allocations;
+};
+
+Totals totalsFor(std::uint32_t site) {
+    Totals t{0, 0, 0, 0};
+    for (Buffer* b = buffers.load(std::memory_order_acquire); b; b = b->next) {
+        const ProfileCounters& c = b->counters[site];
+        t.invocations += c.invocations.load(std::memory_order_relaxed);
+        t.cycles += c.cycles.load(std::memory_order_relaxed);
+        t.loopTrips += c.loopTrips.load(std::memory_order_relaxed);
+        t.allocations += c.allocations.load(std::memory_order_relaxed);
+    }
+    return t;
+}
+
+void dumpSignalHandler(int) {
+    writeProfileDump(2);
+}
+
+} // namespace
+
+namespace detail {
+thread_local std::uint32_t profileCurrentSite = kNoProfileSite;
+}
+
+std::uint32_t profileRegisterSite(const std::string& name, ProfileKind kind) {
+    std::lock_guard<std::mutex> lock(registerMutex);
+    std::uint32_t id = siteCount.load(std::memory_order_relaxed);
+    if (id >= kMaxProfileSites) throw MblError("Too many profile sites");
+    std::size_t n = name.size() < kNameBytes - 1 ? name.size() : kNameBytes - 1;
+    std::memcpy(siteInfo[id].name, name.data(), n);
+    siteInfo[id].name[n] = '\0';
+    siteInfo[id].kind = kind;
+    siteCount.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+ProfileCounters& profileSlot(std::uint32_t site) {
+    return threadBuffer().counters[site];
+}
+
+std::uint64_t profileTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (std::uint64_t)ts.tv_sec * 1000000000ull + (std::uint64_t)ts.tv_nsec;
+#endif
+}
+
+void profileNoteAllocation() {
+    std::uint32_t site = detail::profileCurrentSite;
+    if (site == kNoProfileSite) return;
+    ProfileCounters& c = profileSlot(site);
+    c.allocations.store(c.allocations.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+}
+
+ProfileScope::ProfileScope(std::uint32_t site) : site_(site) {
+    if (site == kNoProfileSite) return;
+    previous_ = detail::profileCurrentSite;
+    detail::profileCurrentSite = site;
+    start_ = profileTicks();
+}
+
+ProfileScope::~ProfileScope() {
+    if (site_ == kNoProfileSite) return;
+    ProfileCounters& c = profileSlot(site_);
+    c.invocations.store(c.invocations.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+    c.cycles.store(c.cycles.load(std::memory_order_relaxed) + profileTicks() - start_,
+                   std::memory_order_relaxed);
+    detail::profileCurrentSite = previous_;
+}
+
+Object* profileReport() {
+    Object* report = Object::create();
+    std::uint32_t n = siteCount.load(std::memory_order_acquire);
+    for (std::uint32_t id = 0; id < n; ++id) {
+        Totals t = totalsFor(id);
+        Object* entry = Object::create();
+        entry->set(intern("kind"), Value::ofText(new std::string(
+            siteInfo[id].kind == ProfileKind::Function ? "Function" : "Loop")));
+        entry->set(intern("invocations"), Value::ofInt((std::int64_t)t.invocations));
+        entry->set(intern("cycles"), Value::ofInt((std::int64_t)t.cycles));
+        entry->set(intern("loopTrips"), Value::ofInt((std::int64_t)t.loopTrips));
+        entry->set(intern("allocations"), Value::ofInt((std::int64_t)t.allocations));
+        report->set(intern(siteInfo[id].name), Value::ofObject(entry));
+    }
+    return report;
+}
+
+void writeProfileDump(int fd) {
+    char line[192];
+    int len = std::snprintf(line, sizeof(line), "%-28s %-8s %12s %16s %12s %12s\n",
+                            "site", "kind", "calls", "cycles", "loop trips", "allocs");
+    if (len > 0) (void)!::write(fd, line, (std::size_t)len);
+    std::uint32_t n = siteCount.load(std::memory_order_acquire);
+    for (std::uint32_t id = 0; id < n; ++id) {
+        Totals t = totalsFor(id);
+        len = std::snprintf(line, sizeof(line),
+                            "%-28s %-8s %12llu %16llu %12llu %12llu\n",
+                            siteInfo[id].name,
+                            siteInfo[id].kind == ProfileKind::Function ? "Function" : "Loop",
+                            (unsigned long long)t.invocations,
+                            (unsigned long long)t.cycles,
+                            (unsigned long long)t.loopTrips,
+                            (unsigned long long)t.allocations);
+        if (len > 0) (void)!::write(fd, line, (std::size_t)len);
+    }
+}
+
+void installProfileDump(int signo) {
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = dumpSignalHandler;
+    sa.sa_flags = SA_RESTART;
+    if (::sigaction(signo, &sa, nullptr) != 0) {
+        throw MblError("Cannot install profile dump handler");
+    }
+}
+
+} // namespace mbl
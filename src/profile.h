@@ -0,0 +1,93 @@
+#ifndef MBL_PROFILE_H
+#define MBL_PROFILE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace mbl {
+
+struct Object;
+
+// Always-on production profiling.  Every compiled Function (and any loop
+// the compiler cares to name) registers a site once at compile time; the
+// VM then charges invocations, cycles, loop trips and allocations to the
+// running site through per-thread counter buffers -- no locks, no
+// sampling thread, no rerunning the 2am batch under a profiler.  The
+// counters are relaxed atomics that compile to plain stores; the cost per
+// function call is two timestamp reads and three increments, which is why
+// this can stay on in production.
+//
+// Two ways out: profileReport() builds the `Runtime.profile` object the
+// language exposes, and installProfileDump() arranges a human-readable
+// table on a signal (SIGUSR1 by default), so a wedged or degraded job can
+// be asked what it is doing without stopping it.
+//
+// Site storage is fixed-capacity so the signal path touches no allocator:
+// names are copied into static slots at registration and buffers are
+// never freed (a finished thread's counts remain part of the totals).
+
+constexpr std::uint32_t kMaxProfileSites = 256;
+constexpr std::uint32_t kNoProfileSite = 0xFFFFFFFF;
+
+enum class ProfileKind : std::uint8_t { Function, Loop };
+
+struct ProfileCounters {
+    std::atomic<std::uint64_t> invocations{0};
+    std::atomic<std::uint64_t> cycles{0};
+    std::atomic<std::uint64_t> loopTrips{0};
+    std::atomic<std::uint64_t> allocations{0};
+};
+
+// Registers a named site (a Function or one loop inside it) and returns
+// its id.  Called once per site at compile time; throws MblError past the
+// capacity, which a compiled program never reaches.
+std::uint32_t profileRegisterSite(const std::string& name, ProfileKind kind);
+
+// This thread's counter slot for a site.
+ProfileCounters& profileSlot(std::uint32_t site);
+
+namespace detail {
+extern thread_local std::uint32_t profileCurrentSite;
+}
+
+// Cycle timestamp: rdtsc where the ISA has it, monotonic nanoseconds
+// otherwise.  Only deltas are meaningful.
+std::uint64_t profileTicks();
+
+// Charges one allocation to the site currently running on this thread;
+// called from Object::create / List::create.  A single thread-local read
+// and a predictable branch when nothing is being profiled.
+void profileNoteAllocation();
+
+// RAII function-entry bracket used by VM::run: charges one invocation and
+// the elapsed ticks, and makes `site` the attribution target for
+// allocations until it closes.  A kNoProfileSite bracket does nothing.
+class ProfileScope {
+public:
+    explicit ProfileScope(std::uint32_t site);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    std::uint32_t site_;
+    std::uint32_t previous_;
+    std::uint64_t start_;
+};
+
+// Builds the Runtime.profile object: one child object per site, carrying
+// invocations / cycles / loopTrips / allocations summed across threads.
+Object* profileReport();
+
+// Writes the same totals as a text table to `fd` using only write(2) and
+// stack buffers -- safe to call from a signal handler.
+void writeProfileDump(int fd);
+
+// Installs writeProfileDump(stderr) as the handler for `signo`.
+void installProfileDump(int signo);
+
+} // namespace mbl
+
+#endif
@@ -0,0 +1,292 @@
+#include "reactor.h"
+
+#include "error.h"
+
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace mbl {
+
+Reactor& Reactor::global() {
+    static Reactor reactor;
+    return reactor;
+}
+
+Reactor::Reactor() {
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epollFd_ < 0 || wakeFd_ < 0) throw MblError("Cannot start the I/O reactor");
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wakeFd_;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &ev);
+
+    thread_ = std::thread([this] { loop(); });
+}
+
+Reactor::~Reactor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake();
+    thread_.join();
+    ::close(wakeFd_);
+    ::close(epollFd_);
+}
+
+void Reactor::wake() {
+    std::uint64_t one = 1;
+    (void)!::write(wakeFd_, &one, sizeof(one));
+}
+
+void Reactor::add(int fd, std::uint32_t events, IoCallback cb) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        handlers_[fd] = std::move(cb);
+    }
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        throw MblError("Cannot register descriptor with the reactor");
+    }
+}
+
+void Reactor::modify(int fd, std::uint32_t events) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void Reactor::remove(int fd) {
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+    std::lock_guard<std::mutex> lock(mutex_);
+    handlers_.erase(fd);
+}
+
+void Reactor::post(Callback fn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        posted_.push_back(std::move(fn));
+    }
+    wake();
+}
+
+void Reactor::runAfter(std::chrono::milliseconds delay, Callback fn) {
+    auto due = std::chrono::steady_clock::now() + delay;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        timers_.push_back(Timer{due, std::move(fn)});
+        std::push_heap(timers_.begin(), timers_.end(),
+                       [](const Timer& a, const Timer& b) { return a.due > b.due; });
+    }
+    wake();
+}
+
+void Reactor::loop() {
+    epoll_event events[64];
+    for (;;) {
+        int timeoutMs = -1;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return;
+            if (!timers_.empty()) {
+                auto wait = timers_.front().due - std::chrono::steady_clock::now();
+                auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(wait).count();
+                timeoutMs = ms < 0 ? 0 : (int)ms;
+            }
+        }
+
+        int n = epoll_wait(epollFd_, events, 64, timeoutMs);
+
+        // Posted work and due timers first, so post() has predictable
+        // latency even under socket load.
+        std::vector<Callback> runnable;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            runnable.swap(posted_);
+            auto now = std::chrono::steady_clock::now();
+            while (!timers_.empty() && timers_.front().due <= now) {
+                std::pop_heap(timers_.begin(), timers_.end(),
+                              [](const Timer& a, const Timer& b) { return a.due > b.due; });
+                runnable.push_back(std::move(timers_.back().fn));
+                timers_.pop_back();
+            }
+        }
+        for (Callback& fn : runnable) fn();
+
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd_) {
+                std::uint64_t drain;
+                (void)!::read(wakeFd_, &drain, sizeof(drain));
+                continue;
+            }
+            IoCallback handler;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = handlers_.find(fd);
+                if (it == handlers_.end()) continue;
+                handler = it->second;  // copy: the callback may remove(fd)
+            }
+            handler(events[i].events);
+        }
+    }
+}
+
+// --- TcpConnection -------------------------------------------------------
+
+std::shared_ptr<TcpConnection> TcpConnection::connect(Reactor& reactor,
+                                                      const std::string& host,
+                                                      std::uint16_t port,
+                                                      DataFn onData,
+                                                      ClosedFn onClosed) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) {
+        throw MblError("Cannot resolve host: " + host);
+    }
+
+    int fd = socket(result->ai_family,
+                    result->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    result->ai_protocol);
+    if (fd < 0) {
+        freeaddrinfo(result);
+        throw MblError("Cannot create socket");
+    }
+    int rc = ::connect(fd, result->ai_addr, result->ai_addrlen);
+    freeaddrinfo(result);
+    if (rc != 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        throw MblError("Cannot connect to " + host);
+    }
+
+    std::shared_ptr<TcpConnection> conn(
+        new TcpConnection(reactor, fd, std::move(onData), std::move(onClosed)));
+    // The registered callback keeps the connection alive while I/O is
+    // pending; finish() breaks the cycle by removing the fd.
+    reactor.add(fd, conn->wantedEvents(),
+                [conn](std::uint32_t events) { conn->onEvents(events); });
+    return conn;
+}
+
+TcpConnection::TcpConnection(Reactor& reactor, int fd, DataFn onData, ClosedFn onClosed)
+    : reactor_(reactor), fd_(fd), onData_(std::move(onData)), onClosed_(std::move(onClosed)) {}
+
+TcpConnection::~TcpConnection() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+std::uint32_t TcpConnection::wantedEvents() const {
+    // While connecting, completion surfaces as writability; afterwards we
+    // always want reads and add writes only while the queue is non-empty.
+    // Even this emptiness probe needs the lock: send() appends to the
+    // string from arbitrary threads.
+    if (connecting_) return EPOLLOUT;
+    std::uint32_t events = EPOLLIN;
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    if (!sendBuf_.empty()) events |= EPOLLOUT;
+    return events;
+}
+
+void TcpConnection::send(std::string data) {
+    {
+        std::lock_guard<std::mutex> lock(sendMutex_);
+        sendBuf_ += data;
+    }
+    auto self = shared_from_this();
+    reactor_.post([self] {
+        if (!self->finished_ && !self->connecting_) {
+            self->reactor_.modify(self->fd_, self->wantedEvents());
+        }
+    });
+}
+
+void TcpConnection::close() {
+    auto self = shared_from_this();
+    reactor_.post([self] { self->finish(""); });
+}
+
+void TcpConnection::onEvents(std::uint32_t events) {
+    if (finished_) return;
+
+    if (connecting_) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0) {
+            finish(std::string("Connect failed: ") + std::strerror(err));
+            return;
+        }
+        connecting_ = false;
+        reactor_.modify(fd_, wantedEvents());
+        return;
+    }
+
+    if (events & EPOLLOUT) {
+        int sendError = 0;
+        {
+            std::lock_guard<std::mutex> lock(sendMutex_);
+            while (!sendBuf_.empty()) {
+                ssize_t wrote = ::write(fd_, sendBuf_.data(), sendBuf_.size());
+                if (wrote > 0) {
+                    sendBuf_.erase(0, (std::size_t)wrote);
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                sendError = errno;
+                break;
+            }
+        }
+        if (sendError) {
+            finish(std::string("Send failed: ") + std::strerror(sendError));
+            return;
+        }
+        reactor_.modify(fd_, wantedEvents());
+    }
+
+    if (events & EPOLLIN) {
+        char buf[16 * 1024];
+        for (;;) {
+            ssize_t got = ::read(fd_, buf, sizeof(buf));
+            if (got > 0) {
+                if (onData_) onData_(buf, (std::size_t)got);
+                continue;
+            }
+            if (got == 0) {
+                finish("");  // peer closed cleanly
+                return;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            finish(std::string("Receive failed: ") + std::strerror(errno));
+            return;
+        }
+    }
+
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        finish("Connection reset");
+    }
+}
+
+void TcpConnection::finish(const std::string& error) {
+    if (finished_) return;
+    finished_ = true;
+    reactor_.remove(fd_);  // drops the reactor's reference to this
+    ::close(fd_);
+    fd_ = -1;
+    if (onClosed_) onClosed_(error);
+}
+
+} // namespace mbl
@@ -0,0 +1,118 @@
+#ifndef MBL_REACTOR_H
+#define MBL_REACTOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mbl {
+
+// The shared non-blocking I/O core under the web services, email and file
+// transfer libraries.  One background thread runs an epoll loop; sockets
+// register interest and get called back when they become readable or
+// writable, so a Tool that fans out to ten downstream services has all
+// ten requests in flight at once and waits only for the slowest peer.
+//
+// The runtime is C++17, so "MBL-level coroutines" surface here as
+// completion callbacks: each async operation takes the function to run
+// when it finishes, and those callbacks run on the reactor thread.
+// Callbacks must therefore not block -- hand heavy work to the Scheduler.
+class Reactor {
+public:
+    using Callback = std::function<void()>;
+    // Receives the epoll event mask (EPOLLIN / EPOLLOUT / EPOLLERR ...).
+    using IoCallback = std::function<void(std::uint32_t events)>;
+
+    // The process-wide reactor, started on first use.
+    static Reactor& global();
+
+    Reactor();
+    ~Reactor();
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // Registers `fd` for `events`; `cb` fires on the reactor thread each
+    // time any of them is ready.  The fd must already be non-blocking.
+    void add(int fd, std::uint32_t events, IoCallback cb);
+    void modify(int fd, std::uint32_t events);
+    void remove(int fd);
+
+    // Runs `fn` on the reactor thread as soon as possible; safe from any
+    // thread.
+    void post(Callback fn);
+
+    // Runs `fn` on the reactor thread after `delay`; the timer backbone
+    // for request timeouts.
+    void runAfter(std::chrono::milliseconds delay, Callback fn);
+
+private:
+    void loop();
+    void wake();
+
+    int epollFd_ = -1;
+    int wakeFd_ = -1;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    std::mutex mutex_;  // guards handlers_, posted_ and timers_
+    std::unordered_map<int, IoCallback> handlers_;
+    std::vector<Callback> posted_;
+    struct Timer {
+        std::chrono::steady_clock::time_point due;
+        Callback fn;
+    };
+    std::vector<Timer> timers_;  // min-heap on `due`
+};
+
+// One asynchronous TCP connection.  Connection setup, sends and receives
+// all complete through callbacks on the reactor thread; send() queues and
+// returns immediately.  Instances are shared-ownership because the
+// reactor holds a reference while I/O is pending.
+class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
+public:
+    using DataFn = std::function<void(const char* data, std::size_t n)>;
+    // Called once, on clean close (empty message) or failure.
+    using ClosedFn = std::function<void(const std::string& error)>;
+
+    // Resolves `host` (blocking, on the calling thread) and starts a
+    // non-blocking connect.  `onData` fires per received chunk; `onClosed`
+    // fires exactly once when the connection ends either way.
+    static std::shared_ptr<TcpConnection> connect(Reactor& reactor,
+                                                  const std::string& host,
+                                                  std::uint16_t port,
+                                                  DataFn onData,
+                                                  ClosedFn onClosed);
+
+    ~TcpConnection();
+
+    // Queues `data` for sending; safe from any thread.
+    void send(std::string data);
+    void close();
+
+private:
+    TcpConnection(Reactor& reactor, int fd, DataFn onData, ClosedFn onClosed);
+    void onEvents(std::uint32_t events);
+    void finish(const std::string& error);
+    std::uint32_t wantedEvents() const;
+
+    Reactor& reactor_;
+    int fd_;
+    bool connecting_ = true;
+    bool finished_ = false;
+    DataFn onData_;
+    ClosedFn onClosed_;
+    // Guards sendBuf_; mutable because wantedEvents() is a const probe but
+    // must still lock against concurrent send() appends.
+    mutable std::mutex sendMutex_;
+    std::string sendBuf_;  // bytes queued but not yet written
+};
+
+} // namespace mbl
+
+#endif
@@ -0,0 +1,237 @@
+#include "flatfile.h"
+
+#include "../error.h"
+#include "../object.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mbl {
+
+namespace {
+
+std::string_view trimmed(const char* p, std::size_t n) {
+    while (n && (p[0] == ' ' || p[0] == '\t')) { ++p; --n; }
+    while (n && (p[n - 1] == ' ' || p[n - 1] == '\t')) --n;
+    return std::string_view(p, n);
+}
+
+// Accumulation bounds for the in-place parsers.  These fields come from
+// external files, so a digit run that cannot fit must throw like
+// Money::fromString does, not silently wrap.
+constexpr std::int64_t kMaxInt = std::numeric_limits<std::int64_t>::max();
+const __int128 kMaxUnits = ~(__int128(1) << 127);
+
+} // namespace
+
+std::string_view RecordView::field(std::size_t i) const {
+    const FlatFileLayout::Field& f = layout_->fields()[i];
+    if (f.offset >= length_) return std::string_view();
+    std::uint32_t width = f.width;
+    if (f.offset + width > length_) width = length_ - f.offset;
+    return trimmed(data_ + f.offset, width);
+}
+
+std::string_view RecordView::fieldNamed(Symbol name) const {
+    int i = layout_->indexOf(name);
+    if (i < 0) throw MblError("Record layout has no field named " + symbolName(name));
+    return field((std::size_t)i);
+}
+
+std::int64_t RecordView::fieldInt(std::size_t i) const {
+    std::string_view v = field(i);
+    std::int64_t out = 0;
+    bool negative = false;
+    std::size_t k = 0;
+    if (k < v.size() && (v[k] == '-' || v[k] == '+')) negative = (v[k++] == '-');
+    if (k == v.size()) throw MblError("Field is not a number: \"" + std::string(v) + "\"");
+    for (; k < v.size(); ++k) {
+        if (v[k] < '0' || v[k] > '9')
+            throw MblError("Field is not a number: \"" + std::string(v) + "\"");
+        int digit = v[k] - '0';
+        if (out > (kMaxInt - digit) / 10)
+            throw MblError("Field is not a number: \"" + std::string(v) + "\"");
+        out = out * 10 + digit;
+    }
+    return negative ? -out : out;
+}
+
+Money RecordView::fieldMoney(std::size_t i) const {
+    // Parse directly from the view; Money::fromString wants a std::string,
+    // so reimplement the inner loop here rather than allocate per field.
+    std::string_view v = field(i);
+    std::size_t k = 0;
+    bool negative = false;
+    if (k < v.size() && (v[k] == '-' || v[k] == '+')) negative = (v[k++] == '-');
+    __int128 whole = 0;
+    bool any = false;
+    for (; k < v.size() && v[k] >= '0' && v[k] <= '9'; ++k) {
+        int digit = v[k] - '0';
+        if (whole > (kMaxUnits / Money::Scale - digit) / 10)
+            throw MblError("Field is not a Money amount: \"" + std::string(v) + "\"");
+        whole = whole * 10 + digit;
+        any = true;
+    }
+    __int128 frac = 0;
+    int fracDigits = 0;
+    if (k < v.size() && v[k] == '.') {
+        for (++k; k < v.size() && v[k] >= '0' && v[k] <= '9'; ++k) {
+            if (++fracDigits > 9)
+                throw MblError("Money field has more than nine fractional digits");
+            frac = frac * 10 + (v[k] - '0');
+            any = true;
+        }
+    }
+    if (!any || k != v.size())
+        throw MblError("Field is not a Money amount: \"" + std::string(v) + "\"");
+    for (; fracDigits < 9; ++fracDigits) frac *= 10;
+    __int128 units = whole * Money::Scale;
+    if (units > kMaxUnits - frac)
+        throw MblError("Field is not a Money amount: \"" + std::string(v) + "\"");
+    units += frac;
+    return Money(negative ? -units : units);
+}
+
+DateTime RecordView::fieldDate(std::size_t i) const {
+    std::string_view v = field(i);
+    int digits[8];
+    int count = 0;
+    for (char ch : v) {
+        if (ch >= '0' && ch <= '9') {
+            if (count == 8) count = 9;  // too many; fail below
+            else digits[count++] = ch - '0';
+        } else if (ch != '/' && ch != '-') {
+            count = 9;
+        }
+        if (count == 9) break;
+    }
+    if (count != 8) throw MblError("Field is not a date: \"" + std::string(v) + "\"");
+    int year = ((digits[0] * 10 + digits[1]) * 10 + digits[2]) * 10 + digits[3];
+    int month = digits[4] * 10 + digits[5];
+    int day = digits[6] * 10 + digits[7];
+    return DateTime::make(year, month, day, 0, 0, 0);
+}
+
+void RecordMaterializer::use(Symbol name) {
+    int i = layout_.indexOf(name);
+    if (i < 0) throw MblError("Record layout has no field named " + symbolName(name));
+    if (std::find(used_.begin(), used_.end(), (std::size_t)i) == used_.end()) {
+        used_.push_back((std::size_t)i);
+    }
+}
+
+Value RecordMaterializer::decode(const RecordView& rec, std::size_t i) const {
+    switch (layout_.fields()[i].type) {
+        case FlatFileLayout::FieldType::Integer:
+            return Value::ofInt(rec.fieldInt(i));
+        case FlatFileLayout::FieldType::MoneyAmount:
+            return Value::ofMoney(rec.fieldMoney(i));
+        case FlatFileLayout::FieldType::Date:
+            return Value::ofDate(rec.fieldDate(i));
+        case FlatFileLayout::FieldType::Text:
+            break;
+    }
+    return Value::ofText(new std::string(rec.field(i)));
+}
+
+void RecordMaterializer::materialize(const RecordView& rec, Object* into) const {
+    for (std::size_t i : used_) {
+        into->set(layout_.fields()[i].name, decode(rec, i));
+    }
+}
+
+Value RecordMaterializer::fetch(const RecordView& rec, Object* into, Symbol name) const {
+    Value present = into->get(name);
+    if (!present.isMissing()) return present;
+    int i = layout_.indexOf(name);
+    if (i < 0) throw MblError("Record layout has no field named " + symbolName(name));
+    Value v = decode(rec, (std::size_t)i);
+    into->set(name, v);
+    return v;
+}
+
+FlatFileReader::FlatFileReader(const std::string& path, const FlatFileLayout& layout,
+                               std::uint32_t recordLength)
+    : layout_(layout), recordLength_(recordLength) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw MblError("Cannot open file: " + path);
+
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        size_ = (std::size_t)st.st_size;
+        if (size_ > 0) {
+            void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                ::madvise(map, size_, MADV_SEQUENTIAL);
+                base_ = (const char*)map;
+                mapped_ = true;
+            }
+        }
+        ::close(fd);
+        if (size_ > 0 && !mapped_) throw MblError("Cannot map file: " + path);
+        return;
+    }
+
+    // Not a regular file (pipe, device): drain it into one buffer.  Loses
+    // the zero-copy-from-page-cache property but keeps the same view API.
+    std::size_t capacity = 1 << 20;
+    char* buffer = (char*)std::malloc(capacity);
+    if (!buffer) { ::close(fd); throw MblError("Out of memory reading: " + path); }
+    std::size_t used = 0;
+    for (;;) {
+        if (used == capacity) {
+            capacity *= 2;
+            char* grown = (char*)std::realloc(buffer, capacity);
+            if (!grown) {
+                std::free(buffer);
+                ::close(fd);
+                throw MblError("Out of memory reading: " + path);
+            }
+            buffer = grown;
+        }
+        ssize_t got = ::read(fd, buffer + used, capacity - used);
+        if (got < 0) { std::free(buffer); ::close(fd); throw MblError("Read error: " + path); }
+        if (got == 0) break;
+        used += (std::size_t)got;
+    }
+    ::close(fd);
+    base_ = buffer;
+    size_ = used;
+}
+
+FlatFileReader::~FlatFileReader() {
+    if (mapped_) ::munmap((void*)base_, size_);
+    else std::free((void*)base_);
+}
+
+bool FlatFileReader::next(RecordView& out) {
+    if (at_ >= size_) return false;
+
+    if (recordLength_ > 0) {
+        std::size_t remain = size_ - at_;
+        std::uint32_t len = remain < recordLength_ ? (std::uint32_t)remain : recordLength_;
+        out = RecordView(base_ + at_, len, &layout_);
+        at_ += len;
+        // Tolerate a newline (or CRLF) between fixed-length records.
+        if (at_ < size_ && base_[at_] == '\r') ++at_;
+        if (at_ < size_ && base_[at_] == '\n') ++at_;
+    } else {
+        const char* start = base_ + at_;
+        const char* nl = (const char*)std::memchr(start, '\n', size_ - at_);
+        std::size_t len = nl ? (std::size_t)(nl - start) : size_ - at_;
+        std::size_t lineLen = len;
+        if (lineLen && start[lineLen - 1] == '\r') --lineLen;
+        out = RecordView(start, (std::uint32_t)lineLen, &layout_);
+        at_ += len + (nl ? 1 : 0);
+    }
+    ++recordsRead_;
+    return true;
+}
+
+} // namespace mbl
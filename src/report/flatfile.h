@@ -0,0 +1,154 @@
+#ifndef MBL_REPORT_FLATFILE_H
+#define MBL_REPORT_FLATFILE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../money.h"
+#include "../symbol.h"
+#include "../value.h"
+
+namespace mbl {
+
+// Flat-file side of the report library: fixed-width and line-delimited
+// bank-file parsing at input bandwidth.  The file is memory-mapped (with a
+// chunked read() fallback for pipes), and each record is handed out as a
+// RecordView -- a pointer and length into the mapping.  Nothing is copied
+// and no string is allocated per field: field() returns a string_view into
+// the buffer, and the typed accessors parse Money/integers directly from
+// those bytes.  A 30GB nightly file costs page-cache reads plus whatever
+// fields the job actually touches.
+
+// Describes the fixed-width fields of one record type.  Offsets are
+// zero-based byte positions; names are interned like every identifier.
+class FlatFileLayout {
+public:
+    // How a field decodes when it is materialized into an object; the raw
+    // string_view accessors ignore this.
+    enum class FieldType : std::uint8_t { Text, Integer, MoneyAmount, Date };
+
+    struct Field {
+        Symbol name;
+        std::uint32_t offset;
+        std::uint32_t width;
+        FieldType type;
+    };
+
+    FlatFileLayout& addField(const std::string& name, std::uint32_t offset,
+                             std::uint32_t width, FieldType type = FieldType::Text) {
+        fields_.push_back(Field{intern(name), offset, width, type});
+        return *this;
+    }
+
+    int indexOf(Symbol name) const {
+        for (std::size_t i = 0; i < fields_.size(); ++i) {
+            if (fields_[i].name == name) return (int)i;
+        }
+        return -1;
+    }
+
+    const std::vector<Field>& fields() const { return fields_; }
+
+private:
+    std::vector<Field> fields_;
+};
+
+// One record: a window over the reader's buffer.  Valid until the reader
+// advances past the underlying mapping (for mmap input, the whole run).
+class RecordView {
+public:
+    RecordView() = default;
+    RecordView(const char* data, std::uint32_t length, const FlatFileLayout* layout)
+        : data_(data), length_(length), layout_(layout) {}
+
+    std::string_view raw() const { return std::string_view(data_, length_); }
+
+    // Field by position in the layout, space-trimmed.  Fields that fall
+    // past a short record come back empty rather than faulting.
+    std::string_view field(std::size_t i) const;
+    // By interned name; Symbol is an integer type, so this gets its own
+    // spelling instead of an overload.
+    std::string_view fieldNamed(Symbol name) const;
+
+    // Typed accessors parsing in place: no intermediate string.
+    std::int64_t fieldInt(std::size_t i) const;
+    Money fieldMoney(std::size_t i) const;
+    // YYYYMMDD, with '/' or '-' separators tolerated.
+    DateTime fieldDate(std::size_t i) const;
+
+private:
+    const char* data_ = nullptr;
+    std::uint32_t length_ = 0;
+    const FlatFileLayout* layout_ = nullptr;
+};
+
+// Turns records into MBL objects at the cost of the fields the Tool
+// actually reads, not the fields the file has.  Bank layouts run to 80
+// fields; a typical job touches 6, and decoding the other 74 per record
+// is where most of an ingest job's CPU used to go.
+//
+// The compiler drives it: for every record field a Tool provably reads it
+// calls use() once at compile time, and materialize() then decodes
+// exactly that projection into the object -- same fields in the same
+// order every record, so the objects share one hidden class and the
+// Tool's property caches stay monomorphic.  A read the compiler could
+// not prove (a dynamic field name, a rare branch) goes through fetch(),
+// which decodes that one field on first access and stores it; the
+// object memoizes it from then on.  Either way, parse cost tracks fields
+// used.
+class RecordMaterializer {
+public:
+    explicit RecordMaterializer(const FlatFileLayout& layout) : layout_(layout) {}
+
+    // Declares that the Tool reads this field; unknown names throw
+    // MblError.  Duplicate use() calls are collapsed.
+    void use(Symbol name);
+    void use(const std::string& name) { use(intern(name)); }
+
+    // Decodes the used fields of `rec` into `into`.
+    void materialize(const RecordView& rec, Object* into) const;
+
+    // First-access path: decodes field `name` from `rec`, stores it on
+    // `into`, and returns it.  Fields already present are returned as-is.
+    Value fetch(const RecordView& rec, Object* into, Symbol name) const;
+
+private:
+    Value decode(const RecordView& rec, std::size_t i) const;
+
+    const FlatFileLayout& layout_;
+    std::vector<std::size_t> used_;
+};
+
+// Streams records out of a file.  Fixed-length mode steps a constant
+// record size (plus an optional newline); delimited mode splits on '\n'.
+class FlatFileReader {
+public:
+    // recordLength 0 means newline-delimited records.
+    FlatFileReader(const std::string& path, const FlatFileLayout& layout,
+                   std::uint32_t recordLength = 0);
+    ~FlatFileReader();
+
+    FlatFileReader(const FlatFileReader&) = delete;
+    FlatFileReader& operator=(const FlatFileReader&) = delete;
+
+    // Advances to the next record; false at end of input.  The view points
+    // into the mapping and stays valid for the reader's lifetime.
+    bool next(RecordView& out);
+
+    std::size_t recordsRead() const { return recordsRead_; }
+
+private:
+    const FlatFileLayout& layout_;
+    std::uint32_t recordLength_;
+    const char* base_ = nullptr;   // mapping (or fallback buffer)
+    std::size_t size_ = 0;
+    std::size_t at_ = 0;
+    std::size_t recordsRead_ = 0;
+    bool mapped_ = false;
+};
+
+} // namespace mbl
+
+#endif
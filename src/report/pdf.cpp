@@ -0,0 +1,192 @@
+#include "pdf.h"
+
+#include "../error.h"
+#include "../scheduler.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+namespace mbl {
+
+namespace {
+
+// Reserved object numbers.  The shared objects are written once at open;
+// the page tree and catalog land at close, but every page can already
+// reference them by number -- the xref only needs offsets at the end.
+constexpr std::uint32_t kFontObj = 1;
+constexpr std::uint32_t kBoldFontObj = 2;
+constexpr std::uint32_t kResourcesObj = 3;
+constexpr std::uint32_t kPagesObj = 4;
+constexpr std::uint32_t kCatalogObj = 5;
+constexpr std::uint32_t kFirstPageObj = 6;
+
+void appendEscaped(std::string& out, const std::string& s) {
+    for (char c : s) {
+        if (c == '(' || c == ')' || c == '\\') out.push_back('\\');
+        out.push_back(c);
+    }
+}
+
+void appendTextOp(std::string& content, const char* font, double x, double y,
+                  double size, const std::string& s) {
+    char op[96];
+    int n = std::snprintf(op, sizeof(op), "BT /%s %.2f Tf %.2f %.2f Td (",
+                          font, size, x, y);
+    content.append(op, (std::size_t)n);
+    appendEscaped(content, s);
+    content.append(") Tj ET\n");
+}
+
+} // namespace
+
+void PdfPage::text(double x, double y, double size, const std::string& s) {
+    appendTextOp(content_, "F1", x, y, size, s);
+}
+
+void PdfPage::textBold(double x, double y, double size, const std::string& s) {
+    appendTextOp(content_, "F1B", x, y, size, s);
+}
+
+void PdfPage::line(double x1, double y1, double x2, double y2) {
+    char op[80];
+    int n = std::snprintf(op, sizeof(op), "%.2f %.2f m %.2f %.2f l S\n",
+                          x1, y1, x2, y2);
+    content_.append(op, (std::size_t)n);
+}
+
+PdfWriter::PdfWriter(const std::string& path) : path_(path) {
+    out_ = std::fopen(path.c_str(), "wb");
+    if (!out_) throw MblError("Cannot create PDF: " + path);
+    objOffsets_.resize(kFirstPageObj);  // slots for the reserved objects
+
+    str("%PDF-1.4\n%\xE2\xE3\xCF\xD3\n");
+
+    objOffsets_[kFontObj] = written_;
+    str("1 0 obj\n<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica >>\nendobj\n");
+    objOffsets_[kBoldFontObj] = written_;
+    str("2 0 obj\n<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica-Bold >>\nendobj\n");
+    objOffsets_[kResourcesObj] = written_;
+    str("3 0 obj\n<< /Font << /F1 1 0 R /F1B 2 0 R >> >>\nendobj\n");
+}
+
+PdfWriter::~PdfWriter() {
+    if (closed_) return;
+    try {
+        close();
+    } catch (...) {
+        // Destruction cannot report; an explicit close() can.
+    }
+}
+
+void PdfWriter::raw(const char* data, std::size_t n) {
+    if (std::fwrite(data, 1, n, out_) != n) {
+        throw MblError("PDF write failed: " + path_);
+    }
+    written_ += n;
+}
+
+std::uint32_t PdfWriter::beginObject() {
+    std::uint32_t num = (std::uint32_t)objOffsets_.size();
+    objOffsets_.push_back(written_);
+    char head[24];
+    int n = std::snprintf(head, sizeof(head), "%u 0 obj\n", num);
+    raw(head, (std::size_t)n);
+    return num;
+}
+
+void PdfWriter::endObject() {
+    str("endobj\n");
+}
+
+void PdfWriter::renderPages(std::size_t count,
+                            const std::function<void(std::size_t, PdfPage&)>& render) {
+    if (closed_) throw MblError("PDF already closed: " + path_);
+    std::size_t firstIndex = pageObjects_.size();
+
+    // Hand each page a buffer from the pool; the pool's strings keep the
+    // capacity earlier batches grew, so a steady-state batch allocates
+    // nothing per page.
+    std::vector<PdfPage> pages(count);
+    for (PdfPage& page : pages) {
+        if (!pool_.empty()) {
+            page.content_ = std::move(pool_.back());
+            pool_.pop_back();
+            page.content_.clear();
+        }
+    }
+
+    Scheduler::global().parallelFor(count, 16,
+        [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                render(firstIndex + i, pages[i]);
+            }
+        });
+
+    // Serial assembly: content stream then page dict, in page order, while
+    // this thread alone owns the file position and object numbering.
+    for (PdfPage& page : pages) {
+        std::uint32_t contentObj = beginObject();
+        char head[48];
+        int n = std::snprintf(head, sizeof(head), "<< /Length %zu >>\nstream\n",
+                              page.content_.size());
+        raw(head, (std::size_t)n);
+        str(page.content_);
+        str("\nendstream\n");
+        endObject();
+
+        std::uint32_t pageObj = beginObject();
+        char dict[160];
+        n = std::snprintf(dict, sizeof(dict),
+                          "<< /Type /Page /Parent %u 0 R /MediaBox [0 0 %g %g] "
+                          "/Resources %u 0 R /Contents %u 0 R >>\n",
+                          kPagesObj, PdfPage::Width, PdfPage::Height,
+                          kResourcesObj, contentObj);
+        raw(dict, (std::size_t)n);
+        endObject();
+        pageObjects_.push_back(pageObj);
+
+        page.content_.clear();
+        pool_.push_back(std::move(page.content_));
+    }
+}
+
+void PdfWriter::close() {
+    if (closed_) return;
+    closed_ = true;
+
+    objOffsets_[kPagesObj] = written_;
+    str("4 0 obj\n<< /Type /Pages /Count ");
+    char buf[128];
+    int n = std::snprintf(buf, sizeof(buf), "%zu", pageObjects_.size());
+    raw(buf, (std::size_t)n);
+    str(" /Kids [");
+    for (std::uint32_t obj : pageObjects_) {
+        n = std::snprintf(buf, sizeof(buf), "%u 0 R ", obj);
+        raw(buf, (std::size_t)n);
+    }
+    str("] >>\nendobj\n");
+
+    objOffsets_[kCatalogObj] = written_;
+    str("5 0 obj\n<< /Type /Catalog /Pages 4 0 R >>\nendobj\n");
+
+    std::uint64_t xrefAt = written_;
+    n = std::snprintf(buf, sizeof(buf), "xref\n0 %zu\n", objOffsets_.size());
+    raw(buf, (std::size_t)n);
+    str("0000000000 65535 f \n");
+    for (std::size_t i = 1; i < objOffsets_.size(); ++i) {
+        n = std::snprintf(buf, sizeof(buf), "%010" PRIu64 " 00000 n \n", objOffsets_[i]);
+        raw(buf, (std::size_t)n);
+    }
+    n = std::snprintf(buf, sizeof(buf),
+                      "trailer\n<< /Size %zu /Root 5 0 R >>\nstartxref\n%" PRIu64 "\n%%%%EOF\n",
+                      objOffsets_.size(), xrefAt);
+    raw(buf, (std::size_t)n);
+
+    if (std::fclose(out_) != 0) {
+        out_ = nullptr;
+        throw MblError("PDF write failed: " + path_);
+    }
+    out_ = nullptr;
+}
+
+} // namespace mbl
@@ -0,0 +1,85 @@
+#ifndef MBL_REPORT_PDF_H
+#define MBL_REPORT_PDF_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace mbl {
+
+// PDF writer for statement production.  The shape of the problem is 90k
+// near-identical pages a month: page CONTENT is embarrassingly parallel,
+// page ASSEMBLY (object numbers, byte offsets, the xref table) is
+// inherently serial.  So renderPages() runs the caller's per-page drawing
+// across the scheduler's workers into pooled content buffers, then one
+// serial pass writes the finished streams into the file.  The buffers go
+// back into the pool with their capacity intact, and the font and
+// resource dictionaries are single shared objects every page references
+// -- per-page cost is the drawing itself, not allocation or re-embedding.
+//
+// The drawing surface is deliberately the statement subset: positioned
+// Helvetica text and ruled lines on US-Letter pages.  Content streams are
+// written uncompressed; a statement page is a few hundred bytes of
+// operators.
+
+// One page being drawn.  Coordinates are PDF points (1/72 inch), origin
+// bottom-left; a US-Letter page is 612 x 792.
+class PdfPage {
+public:
+    // Draws `s` at (x, y) in `size`-point Helvetica.
+    void text(double x, double y, double size, const std::string& s);
+    // Bold variant, for headings and totals rows.
+    void textBold(double x, double y, double size, const std::string& s);
+    // A ruled line from (x1, y1) to (x2, y2).
+    void line(double x1, double y1, double x2, double y2);
+
+    static constexpr double Width = 612.0;
+    static constexpr double Height = 792.0;
+
+private:
+    friend class PdfWriter;
+    std::string content_;  // pooled; capacity survives across batches
+};
+
+class PdfWriter {
+public:
+    // Creates the file and writes the header and the shared font objects.
+    // Throws MblError if the file cannot be created.
+    explicit PdfWriter(const std::string& path);
+    ~PdfWriter();
+
+    PdfWriter(const PdfWriter&) = delete;
+    PdfWriter& operator=(const PdfWriter&) = delete;
+
+    // Appends `count` pages: render(pageIndex, page) runs across the
+    // worker pool (pageIndex is absolute within the document), then the
+    // pages are assembled into the file in order.  May be called per
+    // statement batch; pages accumulate until close().
+    void renderPages(std::size_t count,
+                     const std::function<void(std::size_t, PdfPage&)>& render);
+
+    // Writes the page tree, catalog, xref table and trailer, and closes
+    // the file.  Called by the destructor if not called explicitly, but an
+    // explicit close is the only way to observe write errors.
+    void close();
+
+private:
+    std::uint32_t beginObject();
+    void endObject();
+    void raw(const char* data, std::size_t n);
+    void str(const std::string& s) { raw(s.data(), s.size()); }
+
+    std::FILE* out_ = nullptr;
+    std::string path_;
+    std::vector<std::uint64_t> objOffsets_;  // 1-based object number -> offset
+    std::vector<std::uint32_t> pageObjects_; // page dict object numbers, in order
+    std::vector<std::string> pool_;          // idle content buffers
+    std::uint64_t written_ = 0;
+    bool closed_ = false;
+};
+
+} // namespace mbl
+
+#endif
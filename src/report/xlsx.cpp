@@ -0,0 +1,324 @@
+#include "xlsx.h"
+
+#include "../error.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <cstring>
+
+namespace mbl {
+
+namespace {
+
+// Little-endian field writers for the ZIP structures.
+void put16(std::string& out, std::uint16_t v) {
+    out.push_back((char)(v & 0xFF));
+    out.push_back((char)(v >> 8));
+}
+
+void put32(std::string& out, std::uint32_t v) {
+    put16(out, (std::uint16_t)(v & 0xFFFF));
+    put16(out, (std::uint16_t)(v >> 16));
+}
+
+// The classic ZIP fields are 32-bit and this writer does not emit ZIP64;
+// refuse sizes and offsets past 4 GB rather than truncate into a file
+// that unzips to garbage.
+std::uint32_t zip32(std::uint64_t v, const char* what) {
+    if (v > 0xFFFFFFFFull) {
+        throw MblError(std::string("Spreadsheet ") + what +
+                       " exceeds the 4 GB ZIP limit");
+    }
+    return (std::uint32_t)v;
+}
+
+void xmlEscape(std::string& out, const std::string& text) {
+    for (char ch : text) {
+        switch (ch) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            default: out.push_back(ch);
+        }
+    }
+}
+
+// Spreadsheet column letters: 0 -> A, 25 -> Z, 26 -> AA, ...
+void columnRef(std::string& out, std::size_t col) {
+    char letters[8];
+    int n = 0;
+    std::size_t c = col;
+    for (;;) {
+        letters[n++] = (char)('A' + c % 26);
+        if (c < 26) break;
+        c = c / 26 - 1;
+    }
+    while (n) out.push_back(letters[--n]);
+}
+
+const char* kContentTypes =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>"
+    "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+    "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+    "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+    "<Override PartName=\"/xl/workbook.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>"
+    "<Override PartName=\"/xl/worksheets/sheet1.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>"
+    "</Types>";
+
+const char* kRootRels =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>"
+    "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+    "<Relationship Id=\"rId1\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument\" Target=\"xl/workbook.xml\"/>"
+    "</Relationships>";
+
+const char* kWorkbookRels =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>"
+    "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+    "<Relationship Id=\"rId1\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/worksheet\" Target=\"worksheets/sheet1.xml\"/>"
+    "</Relationships>";
+
+} // namespace
+
+XlsxWriter::XlsxWriter(const std::string& path, const std::string& sheetName) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) throw MblError("Cannot create " + path);
+
+    deflate_ = new z_stream();
+    rowBuf_.reserve(4096);
+    compressBuf_.resize(64 * 1024);
+
+    wholeEntry("[Content_Types].xml", kContentTypes);
+    wholeEntry("_rels/.rels", kRootRels);
+
+    std::string workbook =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>"
+        "<workbook xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\" "
+        "xmlns:r=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships\">"
+        "<sheets><sheet name=\"";
+    xmlEscape(workbook, sheetName);
+    workbook += "\" sheetId=\"1\" r:id=\"rId1\"/></sheets></workbook>";
+    wholeEntry("xl/workbook.xml", workbook);
+    wholeEntry("xl/_rels/workbook.xml.rels", kWorkbookRels);
+
+    // The worksheet entry stays open; rows stream into it until close().
+    beginEntry("xl/worksheets/sheet1.xml");
+    const char* head =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>"
+        "<worksheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\">"
+        "<sheetData>";
+    entryData(head, std::strlen(head));
+    sheetOpen_ = true;
+}
+
+XlsxWriter::~XlsxWriter() {
+    if (!closed_) {
+        try { close(); } catch (...) {}  // destructor swallows write errors
+    }
+    delete (z_stream*)deflate_;
+    if (fd_ >= 0) ::close(fd_);
+}
+
+void XlsxWriter::rawWrite(const void* data, std::size_t n) {
+    const char* p = (const char*)data;
+    while (n) {
+        ssize_t wrote = ::write(fd_, p, n);
+        if (wrote < 0) throw MblError("Short write to spreadsheet file");
+        p += wrote;
+        n -= (std::size_t)wrote;
+        fileOffset_ += (std::uint64_t)wrote;
+    }
+}
+
+void XlsxWriter::beginEntry(const std::string& name) {
+    Entry e;
+    e.name = name;
+    e.offset = fileOffset_;
+    entries_.push_back(e);
+
+    // Local header with bit 3 set: sizes and CRC follow the data in a
+    // descriptor, which is what lets the whole file stream in one pass.
+    std::string header;
+    put32(header, 0x04034b50);
+    put16(header, 20);      // version needed
+    put16(header, 0x0008);  // flags: data descriptor
+    put16(header, 8);       // method: deflate
+    put16(header, 0);       // mod time
+    put16(header, 0);       // mod date
+    put32(header, 0);       // crc (in descriptor)
+    put32(header, 0);       // compressed size (in descriptor)
+    put32(header, 0);       // uncompressed size (in descriptor)
+    put16(header, (std::uint16_t)name.size());
+    put16(header, 0);       // extra length
+    header += name;
+    rawWrite(header.data(), header.size());
+
+    z_stream* z = (z_stream*)deflate_;
+    std::memset(z, 0, sizeof(*z));
+    // Negative window bits: raw deflate, no zlib wrapper -- ZIP stores the
+    // bare stream.
+    if (deflateInit2(z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw MblError("deflate initialization failed");
+    }
+}
+
+void XlsxWriter::entryData(const char* data, std::size_t n) {
+    Entry& e = entries_.back();
+    e.crc = (std::uint32_t)crc32(e.crc, (const Bytef*)data, (uInt)n);
+    e.uncompressed += n;
+
+    z_stream* z = (z_stream*)deflate_;
+    z->next_in = (Bytef*)data;
+    z->avail_in = (uInt)n;
+    while (z->avail_in) {
+        z->next_out = (Bytef*)compressBuf_.data();
+        z->avail_out = (uInt)compressBuf_.size();
+        deflate(z, Z_NO_FLUSH);
+        std::size_t produced = compressBuf_.size() - z->avail_out;
+        if (produced) {
+            rawWrite(compressBuf_.data(), produced);
+            e.compressed += produced;
+        }
+    }
+}
+
+void XlsxWriter::endEntry() {
+    Entry& e = entries_.back();
+    z_stream* z = (z_stream*)deflate_;
+    z->next_in = nullptr;
+    z->avail_in = 0;
+    for (;;) {
+        z->next_out = (Bytef*)compressBuf_.data();
+        z->avail_out = (uInt)compressBuf_.size();
+        int rc = deflate(z, Z_FINISH);
+        std::size_t produced = compressBuf_.size() - z->avail_out;
+        if (produced) {
+            rawWrite(compressBuf_.data(), produced);
+            e.compressed += produced;
+        }
+        if (rc == Z_STREAM_END) break;
+        if (rc != Z_OK) throw MblError("deflate failed");
+    }
+    deflateEnd(z);
+
+    std::string descriptor;
+    put32(descriptor, 0x08074b50);
+    put32(descriptor, e.crc);
+    put32(descriptor, zip32(e.compressed, "entry compressed size"));
+    put32(descriptor, zip32(e.uncompressed, "entry uncompressed size"));
+    rawWrite(descriptor.data(), descriptor.size());
+}
+
+void XlsxWriter::wholeEntry(const std::string& name, const std::string& body) {
+    beginEntry(name);
+    entryData(body.data(), body.size());
+    endEntry();
+}
+
+void XlsxWriter::writeRow(const Value* values, std::size_t n) {
+    if (!sheetOpen_) throw MblError("Spreadsheet already closed");
+    ++rowNumber_;
+    std::string& row = rowBuf_;
+    row.clear();
+    row += "<row r=\"";
+    row += std::to_string(rowNumber_);
+    row += "\">";
+    for (std::size_t col = 0; col < n; ++col) {
+        const Value& v = values[col];
+        if (v.isMissing()) continue;
+        row += "<c r=\"";
+        columnRef(row, col);
+        row += std::to_string(rowNumber_);
+        switch (v.tag) {
+            case Tag::Integer:
+                row += "\"><v>";
+                row += std::to_string(v.integer);
+                row += "</v></c>";
+                break;
+            case Tag::Float:
+                row += "\"><v>";
+                row += std::to_string(v.real);
+                row += "</v></c>";
+                break;
+            case Tag::MoneyVal:
+                row += "\"><v>";
+                row += v.money.toString();
+                row += "</v></c>";
+                break;
+            case Tag::Boolean:
+                row += "\" t=\"b\"><v>";
+                row += v.boolean ? '1' : '0';
+                row += "</v></c>";
+                break;
+            case Tag::Date:
+                row += "\" t=\"inlineStr\"><is><t>";
+                row += v.date.toString();
+                row += "</t></is></c>";
+                break;
+            case Tag::Text:
+                row += "\" t=\"inlineStr\"><is><t>";
+                xmlEscape(row, *v.text);
+                row += "</t></is></c>";
+                break;
+            default:
+                throw MblError("Cannot write an object or list into a spreadsheet cell");
+        }
+    }
+    row += "</row>";
+    entryData(row.data(), row.size());
+}
+
+void XlsxWriter::close() {
+    if (closed_) return;
+    if (sheetOpen_) {
+        const char* tail = "</sheetData></worksheet>";
+        entryData(tail, std::strlen(tail));
+        endEntry();
+        sheetOpen_ = false;
+    }
+
+    std::uint64_t dirStart = fileOffset_;
+    std::string dir;
+    for (const Entry& e : entries_) {
+        put32(dir, 0x02014b50);
+        put16(dir, 20);      // version made by
+        put16(dir, 20);      // version needed
+        put16(dir, 0x0008);
+        put16(dir, 8);
+        put16(dir, 0);
+        put16(dir, 0);
+        put32(dir, e.crc);
+        put32(dir, zip32(e.compressed, "entry compressed size"));
+        put32(dir, zip32(e.uncompressed, "entry uncompressed size"));
+        put16(dir, (std::uint16_t)e.name.size());
+        put16(dir, 0);       // extra
+        put16(dir, 0);       // comment
+        put16(dir, 0);       // disk
+        put16(dir, 0);       // internal attrs
+        put32(dir, 0);       // external attrs
+        put32(dir, zip32(e.offset, "entry offset"));
+        dir += e.name;
+    }
+    std::uint32_t dirSize = (std::uint32_t)dir.size();
+    put32(dir, 0x06054b50);  // end of central directory
+    put16(dir, 0);
+    put16(dir, 0);
+    put16(dir, (std::uint16_t)entries_.size());
+    put16(dir, (std::uint16_t)entries_.size());
+    put32(dir, dirSize);
+    put32(dir, zip32(dirStart, "central directory offset"));
+    put16(dir, 0);
+    rawWrite(dir.data(), dir.size());
+
+    if (::close(fd_) != 0) {
+        fd_ = -1;
+        throw MblError("Error closing spreadsheet file");
+    }
+    fd_ = -1;
+    closed_ = true;
+}
+
+} // namespace mbl
@@ -0,0 +1,70 @@
+#ifndef MBL_REPORT_XLSX_H
+#define MBL_REPORT_XLSX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../value.h"
+
+namespace mbl {
+
+// Streaming XLSX writer for report production.  An .xlsx file is a ZIP of
+// XML parts; the expensive part is the worksheet, so this writer never
+// builds a workbook model at all: each row is encoded into one reusable
+// buffer and deflate-compressed straight into the container as it goes.
+// Memory use is the row buffer plus the deflate window -- a few hundred
+// KB -- regardless of whether the sheet has four rows or four million.
+//
+// To keep the stream single-pass the ZIP entries carry their sizes in a
+// trailing data descriptor, and text cells are written inline
+// (t="inlineStr") so no shared-strings table has to accumulate.  Numbers,
+// Money and Floats become number cells; Dates and Text become inline
+// strings; Missing leaves the cell empty.
+class XlsxWriter {
+public:
+    // Creates the file and writes the fixed container parts.  Throws
+    // MblError if the file cannot be created.
+    explicit XlsxWriter(const std::string& path, const std::string& sheetName = "Sheet1");
+    ~XlsxWriter();
+
+    XlsxWriter(const XlsxWriter&) = delete;
+    XlsxWriter& operator=(const XlsxWriter&) = delete;
+
+    // Appends one row of cells.  Rows are written in order, once.
+    void writeRow(const Value* values, std::size_t n);
+
+    // Closes the worksheet, writes the central directory and closes the
+    // file.  Called by the destructor if not called explicitly, but an
+    // explicit close is the only way to observe write errors.
+    void close();
+
+private:
+    struct Entry {
+        std::string name;
+        std::uint32_t crc = 0;
+        std::uint64_t compressed = 0;
+        std::uint64_t uncompressed = 0;
+        std::uint64_t offset = 0;
+    };
+
+    void rawWrite(const void* data, std::size_t n);
+    void beginEntry(const std::string& name);
+    void entryData(const char* data, std::size_t n);
+    void endEntry();
+    void wholeEntry(const std::string& name, const std::string& body);
+
+    int fd_ = -1;
+    std::uint64_t fileOffset_ = 0;
+    std::vector<Entry> entries_;
+    void* deflate_ = nullptr;  // z_stream, kept out of the header
+    std::string rowBuf_;       // reused across writeRow calls
+    std::string compressBuf_;
+    std::uint64_t rowNumber_ = 0;
+    bool sheetOpen_ = false;
+    bool closed_ = false;
+};
+
+} // namespace mbl
+
+#endif
@@ -0,0 +1,40 @@
+#include "resolve.h"
+
+#include "error.h"
+
+namespace mbl {
+
+void ScopeResolver::enterScope() {
+    scopes_.emplace_back();
+}
+
+std::uint16_t ScopeResolver::leaveScope() {
+    if (scopes_.empty()) throw MblError("Scope underflow in the resolver");
+    std::uint16_t count = (std::uint16_t)scopes_.back().slots.size();
+    scopes_.pop_back();
+    return count;
+}
+
+std::uint16_t ScopeResolver::declare(Symbol name) {
+    if (scopes_.empty()) throw MblError("Declaration outside any scope");
+    Scope& scope = scopes_.back();
+    auto it = scope.slots.find(name);
+    if (it != scope.slots.end()) return it->second;
+    std::uint16_t slot = (std::uint16_t)scope.slots.size();
+    scope.slots.emplace(name, slot);
+    return slot;
+}
+
+bool ScopeResolver::resolve(Symbol name, ScopeCoord& out) const {
+    for (std::size_t depth = 0; depth < scopes_.size(); ++depth) {
+        const Scope& scope = scopes_[scopes_.size() - 1 - depth];
+        auto it = scope.slots.find(name);
+        if (it == scope.slots.end()) continue;
+        out.depth = (std::uint16_t)depth;
+        out.slot = it->second;
+        return true;
+    }
+    return false;
+}
+
+} // namespace mbl
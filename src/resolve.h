@@ -0,0 +1,61 @@
+#ifndef MBL_RESOLVE_H
+#define MBL_RESOLVE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "symbol.h"
+
+namespace mbl {
+
+// Compile-time resolution of MBL's cascading scopes.  A name like
+// `payment` inside amortize() is lexically visible somewhere up the
+// Function-inside-Tool-inside-global nesting; walking that chain by name
+// at runtime would put a hash lookup in every loop iteration.  The
+// compiler instead runs this resolver while it walks the source, turning
+// each lexically visible reference into a (depth, slot) coordinate --
+// depth counts enclosing scopes outward from the innermost, slot indexes
+// the frame's value array -- which the VM's GetScoped/SetScoped execute
+// as a two-level array index.
+//
+// Names the resolver cannot see (properties added to a scope object at
+// runtime) stay dynamic: the compiler falls back to GetProp on the scope
+// object through the usual inline cache.  resolve() returning false is
+// that signal.
+
+struct ScopeCoord {
+    std::uint16_t depth;  // 0 = the innermost scope
+    std::uint16_t slot;
+};
+
+class ScopeResolver {
+public:
+    // Opens a nested scope; returns nothing, leaveScope() must pair.
+    void enterScope();
+    // Closes the innermost scope and returns its slot count, which the
+    // compiler emits as the PushScope operand for that scope's frame.
+    std::uint16_t leaveScope();
+
+    // Declares `name` in the innermost scope and returns its slot.
+    // Redeclaring in the same scope returns the existing slot -- MBL
+    // assignment doubles as declaration.
+    std::uint16_t declare(Symbol name);
+
+    // True if `name` is lexically visible, filling `out` with its
+    // coordinate; false means the reference must stay a dynamic property
+    // lookup.
+    bool resolve(Symbol name, ScopeCoord& out) const;
+
+    std::size_t scopeDepth() const { return scopes_.size(); }
+
+private:
+    struct Scope {
+        std::unordered_map<Symbol, std::uint16_t> slots;
+    };
+    std::vector<Scope> scopes_;
+};
+
+} // namespace mbl
+
+#endif
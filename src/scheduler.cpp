@@ -0,0 +1,179 @@
+#include "scheduler.h"
+
+#include "arena.h"
+#include "error.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mbl {
+
+namespace {
+
+struct Task {
+    std::size_t begin, end;
+    const std::function<void(std::size_t, std::size_t)>* body;
+    std::atomic<std::size_t>* remaining;
+    std::atomic<std::size_t>* pending;  // the pool's global task count
+    std::exception_ptr* firstError;
+    std::mutex* errorLock;
+};
+
+// One worker's deque.  A plain mutex per deque: pushes and local pops touch
+// the front, steals take from the back.  Contention is one uncontended lock
+// per grain-sized range, which disappears against the work itself; the
+// stealing discipline is what matters for balance.
+struct WorkQueue {
+    std::mutex lock;
+    std::deque<Task> tasks;
+
+    void push(Task t) {
+        std::lock_guard<std::mutex> hold(lock);
+        tasks.push_front(t);
+    }
+    bool popFront(Task& out) {
+        std::lock_guard<std::mutex> hold(lock);
+        if (tasks.empty()) return false;
+        out = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+    bool stealBack(Task& out) {
+        std::lock_guard<std::mutex> hold(lock);
+        if (tasks.empty()) return false;
+        out = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+};
+
+thread_local int tlsWorkerIndex = -1;  // -1: not a pool thread
+
+void runTask(const Task& t) {
+    try {
+        (*t.body)(t.begin, t.end);
+    } catch (...) {
+        std::lock_guard<std::mutex> hold(*t.errorLock);
+        if (!*t.firstError) *t.firstError = std::current_exception();
+    }
+    t.pending->fetch_sub(1, std::memory_order_acq_rel);
+    t.remaining->fetch_sub(1, std::memory_order_acq_rel);
+}
+
+} // namespace
+
+struct Scheduler::Impl {
+    std::vector<WorkQueue> queues;
+    std::vector<std::thread> threads;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::atomic<bool> shutdown{false};
+    std::atomic<std::size_t> pendingTasks{0};
+
+    explicit Impl(unsigned workers) : queues(workers) {}
+
+    bool findWork(unsigned self, Task& out) {
+        if (queues[self].popFront(out)) return true;
+        for (unsigned hop = 1; hop < queues.size(); ++hop) {
+            if (queues[(self + hop) % queues.size()].stealBack(out)) return true;
+        }
+        return false;
+    }
+
+    void workerLoop(unsigned self) {
+        tlsWorkerIndex = (int)self;
+        for (;;) {
+            Task task;
+            if (findWork(self, task)) {
+                runTask(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> sleep(sleepLock);
+            wake.wait(sleep, [&] {
+                return shutdown.load() || pendingTasks.load(std::memory_order_acquire) != 0;
+            });
+            if (shutdown.load() && pendingTasks.load() == 0) return;
+        }
+    }
+};
+
+Scheduler& Scheduler::global() {
+    static Scheduler pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+}
+
+Scheduler::Scheduler(unsigned workers)
+    : impl_(new Impl(workers)), workerCount_(workers) {
+    for (unsigned w = 0; w < workers; ++w) {
+        impl_->threads.emplace_back([this, w] { impl_->workerLoop(w); });
+    }
+}
+
+Scheduler::~Scheduler() {
+    impl_->shutdown.store(true);
+    impl_->wake.notify_all();
+    for (std::thread& t : impl_->threads) t.join();
+    delete impl_;
+}
+
+void Scheduler::parallelFor(std::size_t n, std::size_t grain,
+                            const std::function<void(std::size_t, std::size_t)>& body) {
+    if (n == 0) return;
+    if (grain == 0) grain = 1;
+    if (n <= grain || workerCount_ == 1) {
+        body(0, n);
+        return;
+    }
+
+    std::atomic<std::size_t> remaining{0};
+    std::exception_ptr firstError;
+    std::mutex errorLock;
+
+    std::size_t taskCount = (n + grain - 1) / grain;
+    remaining.store(taskCount);
+    impl_->pendingTasks.fetch_add(taskCount, std::memory_order_acq_rel);
+
+    unsigned home = tlsWorkerIndex >= 0 ? (unsigned)tlsWorkerIndex : 0;
+    std::size_t at = 0;
+    for (std::size_t t = 0; t < taskCount; ++t) {
+        std::size_t end = at + grain < n ? at + grain : n;
+        Task task{at, end, &body, &remaining, &impl_->pendingTasks, &firstError, &errorLock};
+        impl_->queues[(home + t) % workerCount_].push(task);
+        at = end;
+    }
+    impl_->wake.notify_all();
+
+    // The calling thread works too instead of blocking.
+    unsigned self = tlsWorkerIndex >= 0 ? (unsigned)tlsWorkerIndex : home;
+    Task task;
+    while (remaining.load(std::memory_order_acquire) != 0) {
+        if (impl_->findWork(self, task)) {
+            runTask(task);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    if (firstError) std::rethrow_exception(firstError);
+}
+
+Arena& Scheduler::workerArena() {
+    thread_local Arena arena;
+    return arena;
+}
+
+void parallelMapList(List& input, List& output, const std::function<Value(Value)>& fn) {
+    output.resize(input.size());
+    Scheduler::global().parallelFor(
+        input.size(), List::ChunkSize, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                output.at(i) = fn(input.at(i));
+            }
+        });
+}
+
+} // namespace mbl
@@ -0,0 +1,62 @@
+#ifndef MBL_SCHEDULER_H
+#define MBL_SCHEDULER_H
+
+#include <cstddef>
+#include <functional>
+
+#include "list.h"
+
+namespace mbl {
+
+class Arena;
+
+// Work-stealing thread pool behind MBL's parallel execution mode ("map this
+// Tool over that collection").  Workers own a deque each and push/pop work
+// at the front; an idle worker steals from the back of a victim's deque, so
+// a skewed split (one loan with a 480-month schedule among 2M plain ones)
+// rebalances instead of serializing on the unlucky worker.
+//
+// Sharing rules for MBL-level work: workers may read shared objects (the
+// flavored global scope) freely but must not write them -- the language
+// construct snapshots anything a Tool mutates.  Compiled Chunks are cloned
+// per worker before parallel invocation because their inline caches are
+// warmed in place and are not thread-safe.
+class Scheduler {
+public:
+    // The process-wide pool, sized to the hardware. Built on first use.
+    static Scheduler& global();
+
+    explicit Scheduler(unsigned workers);
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    unsigned workerCount() const { return workerCount_; }
+
+    // Runs body(begin, end) over [0, n) split into grain-sized ranges.  The
+    // calling thread participates; returns when every range has run.  Any
+    // MblError thrown by a range is rethrown (first one wins).
+    void parallelFor(std::size_t n, std::size_t grain,
+                     const std::function<void(std::size_t, std::size_t)>& body);
+
+    // A per-worker arena for allocation inside parallel bodies, created
+    // lazily and reused across jobs on the same worker thread.
+    static Arena& workerArena();
+
+private:
+    struct Impl;
+    Impl* impl_;
+    unsigned workerCount_;
+};
+
+// Maps fn over input in parallel, chunk by chunk, writing results into
+// output at matching positions.  fn must be safe to call concurrently; a
+// body that needs scratch objects should open an ArenaScope over
+// Scheduler::workerArena() and make sure nothing the scope owns escapes
+// into the result Values.
+void parallelMapList(List& input, List& output, const std::function<Value(Value)>& fn);
+
+} // namespace mbl
+
+#endif
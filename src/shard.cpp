@@ -0,0 +1,270 @@
+#include "shard.h"
+
+#include "error.h"
+
+#include <cstring>
+#include <deque>
+#include <string>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace mbl {
+
+namespace {
+
+// One short spin, then yield the CPU: ring handoffs are usually
+// microseconds apart, but a worker mid-shard can hold a ring idle for
+// seconds and burning a core waiting on it helps nobody.
+void relax(unsigned& spins) {
+    if (++spins < 1024) return;
+    struct timespec ts{0, 50000};
+    nanosleep(&ts, nullptr);
+}
+
+constexpr std::uint64_t kShutdown = ~(std::uint64_t)0;
+
+constexpr std::size_t kRequestRingBytes = 64 * 1024;
+constexpr std::size_t kResponseRingBytes = 16 * 1024 * 1024;
+
+struct Request {
+    std::uint64_t shard, begin, end;
+};
+
+} // namespace
+
+ShmRing* ShmRing::create(std::size_t capacity) {
+    std::size_t mapBytes = (sizeof(ShmRing) + capacity + 4095) & ~(std::size_t)4095;
+    void* map = ::mmap(nullptr, mapBytes, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) throw MblError("Cannot map a shared ring");
+    ShmRing* ring = new (map) ShmRing();
+    ring->capacity_ = mapBytes - sizeof(ShmRing);
+    ring->mapBytes_ = mapBytes;
+    return ring;
+}
+
+void ShmRing::destroy() {
+    ::munmap(this, mapBytes_);
+}
+
+void ShmRing::copyIn(std::uint64_t at, const void* src, std::uint64_t n) {
+    std::uint64_t pos = at % capacity_;
+    std::uint64_t first = capacity_ - pos < n ? capacity_ - pos : n;
+    std::memcpy(data() + pos, src, first);
+    std::memcpy(data(), (const std::uint8_t*)src + first, n - first);
+}
+
+void ShmRing::copyOut(std::uint64_t at, void* dst, std::uint64_t n) {
+    std::uint64_t pos = at % capacity_;
+    std::uint64_t first = capacity_ - pos < n ? capacity_ - pos : n;
+    std::memcpy(dst, data() + pos, first);
+    std::memcpy((std::uint8_t*)dst + first, data(), n - first);
+}
+
+void ShmRing::push(const void* frame, std::uint32_t n) {
+    std::uint64_t total = 4 + (std::uint64_t)n;
+    if (total > capacity_) throw MblError("Frame larger than the shared ring");
+    std::uint64_t tail = tail_.load(std::memory_order_relaxed);
+    unsigned spins = 0;
+    while (capacity_ - (tail - head_.load(std::memory_order_acquire)) < total) {
+        relax(spins);
+    }
+    copyIn(tail, &n, 4);
+    copyIn(tail + 4, frame, n);
+    tail_.store(tail + total, std::memory_order_release);
+}
+
+bool ShmRing::tryPop(std::vector<std::uint8_t>& out) {
+    std::uint64_t head = head_.load(std::memory_order_relaxed);
+    if (tail_.load(std::memory_order_acquire) == head) return false;
+    std::uint32_t n;
+    copyOut(head, &n, 4);
+    out.resize(n);
+    copyOut(head + 4, out.data(), n);
+    head_.store(head + 4 + n, std::memory_order_release);
+    return true;
+}
+
+bool ShmRing::pop(std::vector<std::uint8_t>& out, const std::function<bool()>& deadAfter) {
+    unsigned spins = 0;
+    while (!tryPop(out)) {
+        if (deadAfter && deadAfter()) {
+            // Re-check once: the other side may have pushed and then died.
+            if (tryPop(out)) return true;
+            return false;
+        }
+        relax(spins);
+    }
+    return true;
+}
+
+namespace {
+
+struct WorkerLink {
+    ShmRing* requests;
+    ShmRing* responses;
+    pid_t pid = -1;
+    std::ptrdiff_t activeShard = -1;
+    bool alive = false;
+};
+
+[[noreturn]] void workerMain(
+    WorkerLink& link, pid_t supervisor,
+    const std::function<std::vector<std::uint8_t>(std::size_t, std::size_t, std::size_t)>& body) {
+    std::vector<std::uint8_t> msg;
+    auto orphaned = [supervisor] { return ::getppid() != supervisor; };
+    for (;;) {
+        if (!link.requests->pop(msg, orphaned)) ::_exit(0);
+        Request req;
+        std::memcpy(&req, msg.data(), sizeof(req));
+        if (req.shard == kShutdown) ::_exit(0);
+
+        // Response frame: shard, ok flag, then result bytes or the error
+        // text when the shard's body threw.
+        std::vector<std::uint8_t> frame(sizeof(std::uint64_t) + 1);
+        std::memcpy(frame.data(), &req.shard, sizeof(std::uint64_t));
+        try {
+            std::vector<std::uint8_t> result =
+                body((std::size_t)req.shard, (std::size_t)req.begin, (std::size_t)req.end);
+            frame[sizeof(std::uint64_t)] = 1;
+            frame.insert(frame.end(), result.begin(), result.end());
+        } catch (const std::exception& e) {
+            frame[sizeof(std::uint64_t)] = 0;
+            const char* what = e.what();
+            frame.insert(frame.end(), what, what + std::strlen(what));
+        }
+        link.responses->push(frame.data(), (std::uint32_t)frame.size());
+    }
+}
+
+} // namespace
+
+void runSharded(
+    std::size_t n, std::size_t shards, unsigned workers,
+    const std::function<std::vector<std::uint8_t>(std::size_t, std::size_t, std::size_t)>& body,
+    const std::function<void(std::size_t, const std::uint8_t*, std::size_t)>& combine) {
+    if (shards == 0 || n == 0) return;
+    if (workers == 0) workers = 1;
+    if (workers > shards) workers = (unsigned)shards;
+
+    // The rings must exist before the fork so both sides map the pages.
+    std::vector<WorkerLink> links(workers);
+    for (WorkerLink& link : links) {
+        link.requests = ShmRing::create(kRequestRingBytes);
+        link.responses = ShmRing::create(kResponseRingBytes);
+    }
+
+    pid_t supervisor = ::getpid();
+    for (WorkerLink& link : links) {
+        pid_t pid = ::fork();
+        if (pid < 0) throw MblError("Cannot fork a shard worker");
+        if (pid == 0) workerMain(link, supervisor, body);
+        link.pid = pid;
+        link.alive = true;
+    }
+
+    std::deque<std::size_t> pending;
+    for (std::size_t s = 0; s < shards; ++s) pending.push_back(s);
+    std::size_t per = (n + shards - 1) / shards;
+    auto shardRange = [&](std::size_t s, std::size_t& begin, std::size_t& end) {
+        begin = s * per;
+        end = begin + per < n ? begin + per : n;
+    };
+
+    std::vector<ShardFailure> failures;
+    std::vector<std::string> failureTexts;
+    std::size_t outstanding = 0;
+    std::vector<std::uint8_t> msg;
+    unsigned spins = 0;
+
+    for (;;) {
+        bool progressed = false;
+
+        for (WorkerLink& link : links) {
+            if (!link.alive) continue;
+
+            if (link.activeShard < 0 && !pending.empty()) {
+                std::size_t s = pending.front();
+                pending.pop_front();
+                Request req{(std::uint64_t)s, 0, 0};
+                std::size_t begin, end;
+                shardRange(s, begin, end);
+                req.begin = begin;
+                req.end = end;
+                link.requests->push(&req, sizeof(req));
+                link.activeShard = (std::ptrdiff_t)s;
+                ++outstanding;
+                progressed = true;
+            }
+
+            if (link.activeShard >= 0 && link.responses->tryPop(msg)) {
+                std::uint64_t s;
+                std::memcpy(&s, msg.data(), sizeof(s));
+                if (msg[sizeof(s)]) {
+                    combine((std::size_t)s, msg.data() + sizeof(s) + 1,
+                            msg.size() - sizeof(s) - 1);
+                } else {
+                    failures.push_back(ShardFailure{(std::size_t)s, 0});
+                    failureTexts.emplace_back((const char*)msg.data() + sizeof(s) + 1,
+                                              msg.size() - sizeof(s) - 1);
+                }
+                link.activeShard = -1;
+                --outstanding;
+                progressed = true;
+            }
+
+            // A dead worker fails the shard it was running; shards still
+            // pending go to the survivors.
+            int status;
+            if (::waitpid(link.pid, &status, WNOHANG) == link.pid) {
+                link.alive = false;
+                if (link.activeShard >= 0) {
+                    failures.push_back(ShardFailure{(std::size_t)link.activeShard, status});
+                    failureTexts.emplace_back("worker process died");
+                    link.activeShard = -1;
+                    --outstanding;
+                }
+                progressed = true;
+            }
+        }
+
+        if (pending.empty() && outstanding == 0) break;
+
+        bool anyAlive = false;
+        for (const WorkerLink& link : links) anyAlive |= link.alive;
+        if (!anyAlive) {
+            for (std::size_t s : pending) {
+                failures.push_back(ShardFailure{s, 0});
+                failureTexts.emplace_back("no surviving worker");
+            }
+            break;
+        }
+
+        if (progressed) spins = 0;
+        else relax(spins);
+    }
+
+    Request shutdown{kShutdown, 0, 0};
+    for (WorkerLink& link : links) {
+        if (link.alive) link.requests->push(&shutdown, sizeof(shutdown));
+    }
+    for (WorkerLink& link : links) {
+        if (link.alive) ::waitpid(link.pid, nullptr, 0);
+        link.requests->destroy();
+        link.responses->destroy();
+    }
+
+    if (!failures.empty()) {
+        std::string message = "Sharded run failed:";
+        for (std::size_t i = 0; i < failures.size(); ++i) {
+            message += " shard " + std::to_string(failures[i].shard) +
+                       " (" + failureTexts[i] + ")";
+        }
+        throw MblError(message);
+    }
+}
+
+} // namespace mbl
@@ -0,0 +1,82 @@
+#ifndef MBL_SHARD_H
+#define MBL_SHARD_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace mbl {
+
+// Shared-nothing multi-process execution.  Threads (scheduler.h) share a
+// heap; a bad shard can take the whole batch down with it.  This mode
+// forks worker PROCESSES instead: each worker owns its shard of the loan
+// book outright, and a crash -- segfault, heap corruption, OOM kill --
+// costs that shard alone while the supervisor reassigns or reports it.
+//
+// The data plane is shared-memory rings mapped before the fork: frames go
+// straight into the MAP_SHARED mapping and come straight out, no pipes,
+// no serialization layer.  The payloads this was built for are already
+// flat bytes -- Table column slices and graph-file images (graphfile.h)
+// -- so the handoff between stages runs at memcpy speed.
+
+// A single-producer single-consumer byte ring in memory shared across
+// fork().  Frames are length-prefixed; a frame never exceeds the ring
+// capacity.  Producer and consumer must be exactly one process each --
+// that is what keeps the control words two plain atomics.
+class ShmRing {
+public:
+    // Maps a new ring of at least `capacity` payload bytes, MAP_SHARED so
+    // both sides of a later fork see the same pages.
+    static ShmRing* create(std::size_t capacity);
+    // Unmaps; call from each process that is done with its side.
+    void destroy();
+
+    // Copies a frame into the ring, spinning while full.
+    void push(const void* frame, std::uint32_t n);
+    // Pops the next frame into `out` (replacing its contents), spinning
+    // while empty.  Returns false instead of spinning forever if
+    // `deadAfter` becomes true while waiting (the other side died).
+    bool pop(std::vector<std::uint8_t>& out,
+             const std::function<bool()>& deadAfter = nullptr);
+    // Non-blocking pop; false when the ring is empty.
+    bool tryPop(std::vector<std::uint8_t>& out);
+
+private:
+    ShmRing() = default;
+
+    std::atomic<std::uint64_t> head_{0};  // consumer position
+    std::atomic<std::uint64_t> tail_{0};  // producer position
+    std::uint64_t capacity_ = 0;
+    std::uint64_t mapBytes_ = 0;
+    // payload bytes follow the header in the mapping
+
+    std::uint8_t* data() { return (std::uint8_t*)(this + 1); }
+    void copyIn(std::uint64_t at, const void* src, std::uint64_t n);
+    void copyOut(std::uint64_t at, void* dst, std::uint64_t n);
+};
+
+// One shard's outcome when runSharded reports failures.
+struct ShardFailure {
+    std::size_t shard;
+    int workerExitStatus;  // as returned by waitpid
+};
+
+// Splits [0, n) into `shards` contiguous ranges and runs
+// body(shard, begin, end) across `workers` forked processes; the bytes
+// body returns travel back over the worker's ring and are handed to
+// combine(shard, data, size) in the supervisor, in completion order.
+//
+// A worker that dies fails only the shard it was running; remaining
+// shards are rescheduled onto surviving workers.  When any shard fails
+// (worker death, or body throwing MblError), runSharded finishes the
+// rest and then throws MblError naming the failed shards.
+void runSharded(
+    std::size_t n, std::size_t shards, unsigned workers,
+    const std::function<std::vector<std::uint8_t>(std::size_t, std::size_t, std::size_t)>& body,
+    const std::function<void(std::size_t, const std::uint8_t*, std::size_t)>& combine);
+
+} // namespace mbl
+
+#endif
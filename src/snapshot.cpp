@@ -0,0 +1,278 @@
+#include "snapshot.h"
+
+#include "error.h"
+#include "list.h"
+
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mbl {
+
+namespace {
+
+constexpr std::uint32_t kMagic = 0x4D424C53;  // "MBLS"
+constexpr std::uint32_t kVersion = 1;
+
+// Value encoding tags inside the image; independent of Tag's numbering so
+// reordering the runtime enum cannot silently corrupt old images.
+enum : std::uint8_t {
+    kMissing, kBool, kInt, kFloat, kMoney, kDate, kInterval, kText, kObj, kList
+};
+
+struct Writer {
+    FILE* out;
+
+    void bytes(const void* p, std::size_t n) {
+        if (std::fwrite(p, 1, n, out) != n) throw MblError("Snapshot write failed");
+    }
+    void u8(std::uint8_t v) { bytes(&v, 1); }
+    void u32(std::uint32_t v) { bytes(&v, 4); }
+    void u64(std::uint64_t v) { bytes(&v, 8); }
+    void i64(std::int64_t v) { bytes(&v, 8); }
+};
+
+struct GraphIndex {
+    std::unordered_map<const Object*, std::uint32_t> objects;
+    std::unordered_map<const List*, std::uint32_t> lists;
+    std::unordered_map<const std::string*, std::uint32_t> texts;
+    std::vector<const Object*> objectOrder;
+    std::vector<const List*> listOrder;
+    std::vector<const std::string*> textOrder;
+
+    void visitValue(Value v);
+
+    void visitObject(const Object* o) {
+        if (!o || objects.count(o)) return;
+        objects.emplace(o, (std::uint32_t)objectOrder.size());
+        objectOrder.push_back(o);
+        visitObject(o->proto);
+        for (std::uint32_t s = 0; s < o->slots.count; ++s) visitValue(o->slots[s]);
+    }
+
+    void visitList(const List* l) {
+        if (!l || lists.count(l)) return;
+        lists.emplace(l, (std::uint32_t)listOrder.size());
+        listOrder.push_back(l);
+        for (std::size_t i = 0; i < l->size(); ++i) visitValue(l->at(i));
+    }
+};
+
+void GraphIndex::visitValue(Value v) {
+    if (v.tag == Tag::Obj) visitObject(v.object);
+    else if (v.tag == Tag::ListVal) visitList(v.list);
+    else if (v.tag == Tag::Text && v.text && !texts.count(v.text)) {
+        texts.emplace(v.text, (std::uint32_t)textOrder.size());
+        textOrder.push_back(v.text);
+    }
+}
+
+void writeValue(Writer& w, const GraphIndex& g, Value v) {
+    switch (v.tag) {
+        case Tag::Missing: w.u8(kMissing); return;
+        case Tag::Boolean: w.u8(kBool); w.u8(v.boolean ? 1 : 0); return;
+        case Tag::Integer: w.u8(kInt); w.i64(v.integer); return;
+        case Tag::Float: w.u8(kFloat); w.bytes(&v.real, 8); return;
+        case Tag::MoneyVal: w.u8(kMoney); w.bytes(&v.money.units, 16); return;
+        case Tag::Date: w.u8(kDate); w.u64(v.date.packed); return;
+        case Tag::IntervalVal: w.u8(kInterval); w.u64(v.interval); return;
+        case Tag::Text: w.u8(kText); w.u32(g.texts.at(v.text)); return;
+        case Tag::Obj: w.u8(kObj); w.u32(g.objects.at(v.object)); return;
+        case Tag::ListVal: w.u8(kList); w.u32(g.lists.at(v.list)); return;
+    }
+    throw MblError("Snapshot cannot hold this value");
+}
+
+struct Reader {
+    const char* p;
+    const char* end;
+
+    void need(std::size_t n) const {
+        if ((std::size_t)(end - p) < n) throw MblError("Snapshot file is truncated");
+    }
+    void bytes(void* out, std::size_t n) { need(n); std::memcpy(out, p, n); p += n; }
+    std::uint8_t u8() { std::uint8_t v; bytes(&v, 1); return v; }
+    std::uint32_t u32() { std::uint32_t v; bytes(&v, 4); return v; }
+    std::uint64_t u64() { std::uint64_t v; bytes(&v, 8); return v; }
+    std::int64_t i64() { std::int64_t v; bytes(&v, 8); return v; }
+};
+
+Value readValue(Reader& r, const std::vector<Object*>& objects,
+                const std::vector<List*>& lists,
+                const std::vector<std::string*>& texts) {
+    switch (r.u8()) {
+        case kMissing: return Value::missing();
+        case kBool: return Value::ofBool(r.u8() != 0);
+        case kInt: return Value::ofInt(r.i64());
+        case kFloat: { double d; r.bytes(&d, 8); return Value::ofFloat(d); }
+        case kMoney: { Money m; r.bytes(&m.units, 16); return Value::ofMoney(m); }
+        case kDate: { DateTime d; d.packed = r.u64(); return Value::ofDate(d); }
+        case kInterval: return Value::ofInterval(Interval::unpack(r.u64()));
+        case kText: return Value::ofText(texts.at(r.u32()));
+        case kObj: return Value::ofObject(objects.at(r.u32()));
+        case kList: return Value::ofList(lists.at(r.u32()));
+    }
+    throw MblError("Snapshot file is corrupt");
+}
+
+} // namespace
+
+void writeSnapshot(const std::string& path, Object* root) {
+    GraphIndex graph;
+    graph.visitObject(root);
+
+    // Collect the symbols every reachable shape mentions, in first-seen
+    // order, and the per-object shape definitions as symbol index lists.
+    std::unordered_map<Symbol, std::uint32_t> symbolIds;
+    std::vector<Symbol> symbolOrder;
+    auto localSymbol = [&](Symbol s) {
+        auto it = symbolIds.find(s);
+        if (it != symbolIds.end()) return it->second;
+        std::uint32_t id = (std::uint32_t)symbolOrder.size();
+        symbolIds.emplace(s, id);
+        symbolOrder.push_back(s);
+        return id;
+    };
+
+    std::vector<std::vector<std::uint32_t>> shapeDefs;
+    shapeDefs.reserve(graph.objectOrder.size());
+    for (const Object* o : graph.objectOrder) {
+        std::vector<std::uint32_t> def;
+        for (Symbol s : o->shape->names()) def.push_back(localSymbol(s));
+        shapeDefs.push_back(std::move(def));
+    }
+
+    FILE* out = std::fopen(path.c_str(), "wb");
+    if (!out) throw MblError("Cannot create snapshot: " + path);
+    Writer w{out};
+    try {
+        w.u32(kMagic);
+        w.u32(kVersion);
+
+        w.u32((std::uint32_t)symbolOrder.size());
+        for (Symbol s : symbolOrder) {
+            const std::string& name = symbolName(s);
+            w.u32((std::uint32_t)name.size());
+            w.bytes(name.data(), name.size());
+        }
+
+        w.u32((std::uint32_t)graph.textOrder.size());
+        for (const std::string* t : graph.textOrder) {
+            w.u32((std::uint32_t)t->size());
+            w.bytes(t->data(), t->size());
+        }
+
+        w.u32((std::uint32_t)graph.objectOrder.size());
+        w.u32((std::uint32_t)graph.listOrder.size());
+
+        for (std::size_t i = 0; i < graph.objectOrder.size(); ++i) {
+            const Object* o = graph.objectOrder[i];
+            const std::vector<std::uint32_t>& def = shapeDefs[i];
+            w.u32((std::uint32_t)def.size());
+            for (std::uint32_t s : def) w.u32(s);
+            w.u32(o->proto ? graph.objects.at(o->proto) + 1 : 0);
+            for (std::uint32_t s = 0; s < o->slots.count; ++s) {
+                writeValue(w, graph, o->slots[s]);
+            }
+        }
+
+        for (const List* l : graph.listOrder) {
+            w.u64(l->size());
+            for (std::size_t i = 0; i < l->size(); ++i) writeValue(w, graph, l->at(i));
+        }
+
+        w.u32(root ? graph.objects.at(root) : 0);
+    } catch (...) {
+        std::fclose(out);
+        throw;
+    }
+    if (std::fclose(out) != 0) throw MblError("Snapshot write failed: " + path);
+}
+
+Object* loadSnapshot(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw MblError("Cannot open snapshot: " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < 8) {
+        ::close(fd);
+        throw MblError("Snapshot file is truncated: " + path);
+    }
+    std::size_t size = (std::size_t)st.st_size;
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) throw MblError("Cannot map snapshot: " + path);
+
+    try {
+        Reader r{(const char*)map, (const char*)map + size};
+        if (r.u32() != kMagic) throw MblError("Not a snapshot file: " + path);
+        if (r.u32() != kVersion)
+            throw MblError("Snapshot is from an incompatible runtime: " + path);
+
+        std::uint32_t symbolCount = r.u32();
+        std::vector<Symbol> symbols(symbolCount);
+        std::string scratch;
+        for (std::uint32_t i = 0; i < symbolCount; ++i) {
+            std::uint32_t len = r.u32();
+            r.need(len);
+            scratch.assign(r.p, len);
+            r.p += len;
+            symbols[i] = intern(scratch);
+        }
+
+        std::uint32_t textCount = r.u32();
+        std::vector<std::string*> texts(textCount);
+        for (std::uint32_t i = 0; i < textCount; ++i) {
+            std::uint32_t len = r.u32();
+            r.need(len);
+            texts[i] = new std::string(r.p, len);
+            r.p += len;
+        }
+
+        std::uint32_t objectCount = r.u32();
+        std::uint32_t listCount = r.u32();
+
+        // Pass 1 would normally create, pass 2 link; because objects were
+        // written in visit order (an object precedes everything it newly
+        // references except cycles through protos and slots), we create all
+        // shells first, then read bodies against the full tables.
+        std::vector<Object*> objects(objectCount);
+        for (std::uint32_t i = 0; i < objectCount; ++i) objects[i] = Object::create();
+        std::vector<List*> lists(listCount);
+        for (std::uint32_t i = 0; i < listCount; ++i) lists[i] = List::create();
+
+        for (std::uint32_t i = 0; i < objectCount; ++i) {
+            Object* o = objects[i];
+            std::uint32_t propCount = r.u32();
+            std::vector<std::uint32_t> props(propCount);
+            for (std::uint32_t k = 0; k < propCount; ++k) props[k] = r.u32();
+            std::uint32_t protoRef = r.u32();
+            for (std::uint32_t k = 0; k < propCount; ++k) {
+                o->set(symbols.at(props[k]), readValue(r, objects, lists, texts));
+            }
+            if (protoRef) o->setProto(objects.at(protoRef - 1));
+        }
+
+        for (std::uint32_t i = 0; i < listCount; ++i) {
+            std::uint64_t count = r.u64();
+            lists[i]->reserve((std::size_t)count);
+            for (std::uint64_t k = 0; k < count; ++k) {
+                lists[i]->append(readValue(r, objects, lists, texts));
+            }
+        }
+
+        std::uint32_t rootIndex = r.u32();
+        ::munmap(map, size);
+        return objectCount ? objects.at(rootIndex) : nullptr;
+    } catch (...) {
+        ::munmap(map, size);
+        throw;
+    }
+}
+
+} // namespace mbl
@@ -0,0 +1,37 @@
+#ifndef MBL_SNAPSHOT_H
+#define MBL_SNAPSHOT_H
+
+#include <string>
+
+#include "object.h"
+
+namespace mbl {
+
+// Startup heap images.  Building the flavored global object -- the standard
+// language elements plus the default libraries -- is pure deterministic
+// work, so a CLI that does it on every invocation is re-deriving the same
+// heap thousands of times a day.  Instead: build it once, writeSnapshot()
+// it, and have `mbl run` loadSnapshot() the image back.
+//
+// The image is a self-contained binary file: its own symbol strings, shape
+// definitions, and flat tables of objects, lists and texts with indexed
+// cross-references.  Loading mmaps the file and materializes the graph in
+// two passes (create, then link) with no parsing of program text anywhere
+// -- symbol interning and shape-transition replay are the only hash work,
+// and both are proportional to the number of distinct names, not objects.
+//
+// Snapshots are tied to the runtime that wrote them: a version bump in the
+// format invalidates old images and the loader rejects them cleanly.
+
+// Serializes the graph reachable from `root` (objects, lists, texts).
+// Throws MblError on I/O failure or on values a snapshot cannot hold
+// (nothing in a standard environment hits that).
+void writeSnapshot(const std::string& path, Object* root);
+
+// Reconstructs the graph; returns the root object.  Throws MblError if the
+// file is missing, truncated, or from an incompatible runtime.
+Object* loadSnapshot(const std::string& path);
+
+} // namespace mbl
+
+#endif
@@ -0,0 +1,47 @@
+#include "symbol.h"
+
+#include <cctype>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace mbl {
+
+namespace {
+
+struct InternTable {
+    std::mutex lock;
+    std::unordered_map<std::string, Symbol> ids;
+    std::deque<std::string> names;  // indexed by Symbol; deque keeps
+                                    // references stable across interning
+};
+
+InternTable& table() {
+    static InternTable t;
+    return t;
+}
+
+} // namespace
+
+Symbol intern(const std::string& name) {
+    std::string folded;
+    folded.reserve(name.size());
+    for (char c : name) folded += (char)std::tolower((unsigned char)c);
+
+    InternTable& t = table();
+    std::lock_guard<std::mutex> hold(t.lock);
+    auto it = t.ids.find(folded);
+    if (it != t.ids.end()) return it->second;
+    Symbol id = (Symbol)t.names.size();
+    t.names.push_back(folded);
+    t.ids.emplace(t.names.back(), id);
+    return id;
+}
+
+const std::string& symbolName(Symbol s) {
+    InternTable& t = table();
+    std::lock_guard<std::mutex> hold(t.lock);
+    return t.names[s];
+}
+
+} // namespace mbl
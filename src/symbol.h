@@ -0,0 +1,29 @@
+#ifndef MBL_SYMBOL_H
+#define MBL_SYMBOL_H
+
+#include <cstdint>
+#include <string>
+
+namespace mbl {
+
+// Interned identifiers.  MBL is case-insensitive -- Payment, payment and
+// PAYMENT are the same name -- so the front end interns every identifier
+// through a case-folding table at parse time and the rest of the runtime
+// deals only in Symbol IDs: shape lookups, scope resolution and property
+// caches compare 32-bit integers, never strings.
+//
+// Interning happens at parse/compile time and is mutex-protected; symbol
+// IDs are stable for the life of the process and readable back (in folded
+// spelling) for diagnostics and object printing.
+using Symbol = std::uint32_t;
+
+// Folds ASCII upper case to lower; identifiers are ASCII by the language
+// definition.
+Symbol intern(const std::string& name);
+
+// The folded spelling of a previously interned symbol.
+const std::string& symbolName(Symbol s);
+
+} // namespace mbl
+
+#endif
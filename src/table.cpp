@@ -0,0 +1,201 @@
+#include "table.h"
+
+#include "error.h"
+
+namespace mbl {
+
+namespace {
+
+const char* tagName(Tag t) {
+    switch (t) {
+        case Tag::MoneyVal: return "Money";
+        case Tag::Integer: return "Integer";
+        case Tag::Float: return "Float";
+        case Tag::Date: return "Date";
+        default: return "value";
+    }
+}
+
+} // namespace
+
+std::size_t Table::addColumn(const std::string& name, Tag type) {
+    if (rowCount_ != 0) throw MblError("Cannot add a column to a populated table");
+    switch (type) {
+        case Tag::MoneyVal:
+        case Tag::Integer:
+        case Tag::Float:
+        case Tag::Date:
+            break;
+        default:
+            throw MblError("Table columns must be Money, Integer, Float or Date");
+    }
+    Symbol sym = intern(name);
+    for (const Column& c : columns_) {
+        if (c.name == sym) throw MblError("Duplicate table column: " + name);
+    }
+    columns_.push_back(Column{sym, type, {}, {}, {}, {}});
+    return columns_.size() - 1;
+}
+
+std::size_t Table::columnIndex(Symbol name) const {
+    for (std::size_t i = 0; i < columns_.size(); ++i) {
+        if (columns_[i].name == name) return i;
+    }
+    throw MblError("Unknown table column: " + symbolName(name));
+}
+
+void Table::reserve(std::size_t rows) {
+    for (Column& c : columns_) {
+        switch (c.type) {
+            case Tag::MoneyVal: c.money.reserve(rows); break;
+            case Tag::Integer: c.ints.reserve(rows); break;
+            case Tag::Float: c.floats.reserve(rows); break;
+            case Tag::Date: c.dates.reserve(rows); break;
+            default: break;
+        }
+    }
+}
+
+void Table::appendRow(const Value* values) {
+    for (std::size_t i = 0; i < columns_.size(); ++i) {
+        Column& c = columns_[i];
+        const Value& v = values[i];
+        if (v.tag != c.type) {
+            throw MblError(std::string("Column ") + symbolName(c.name) +
+                           " holds " + tagName(c.type) + ", not " + tagName(v.tag));
+        }
+        switch (c.type) {
+            case Tag::MoneyVal: c.money.push_back(v.money); break;
+            case Tag::Integer: c.ints.push_back(v.integer); break;
+            case Tag::Float: c.floats.push_back(v.real); break;
+            case Tag::Date: c.dates.push_back(v.date); break;
+            default: break;
+        }
+    }
+    ++rowCount_;
+    for (auto& observer : observers_) {
+        observer.second->onAppend(rowCount_ - 1, values[observer.first]);
+    }
+}
+
+Value Table::at(std::size_t row, std::size_t col) const {
+    if (row >= rowCount_) throw MblError("Table row out of range");
+    if (col >= columns_.size()) throw MblError("Table column out of range");
+    const Column& c = columns_[col];
+    switch (c.type) {
+        case Tag::MoneyVal: return Value::ofMoney(c.money[row]);
+        case Tag::Integer: return Value::ofInt(c.ints[row]);
+        case Tag::Float: return Value::ofFloat(c.floats[row]);
+        case Tag::Date: return Value::ofDate(c.dates[row]);
+        default: return Value::missing();
+    }
+}
+
+void Table::set(std::size_t row, std::size_t col, Value v) {
+    if (row >= rowCount_) throw MblError("Table row out of range");
+    if (col >= columns_.size()) throw MblError("Table column out of range");
+    Value oldValue = at(row, col);
+    Column& c = columns_[col];
+    if (v.tag != c.type) {
+        throw MblError(std::string("Column ") + symbolName(c.name) +
+                       " holds " + tagName(c.type) + ", not " + tagName(v.tag));
+    }
+    switch (c.type) {
+        case Tag::MoneyVal: c.money[row] = v.money; break;
+        case Tag::Integer: c.ints[row] = v.integer; break;
+        case Tag::Float: c.floats[row] = v.real; break;
+        case Tag::Date: c.dates[row] = v.date; break;
+        default: break;
+    }
+    notifyUpdate(row, col, oldValue, v);
+}
+
+Table::Column& Table::checkedColumn(std::size_t col, Tag expected, const char* what) {
+    if (col >= columns_.size()) throw MblError("Table column out of range");
+    Column& c = columns_[col];
+    if (c.type != expected) {
+        throw MblError(std::string(what) + " needs a " + tagName(expected) +
+                       " column, but " + symbolName(c.name) + " holds " +
+                       tagName(c.type));
+    }
+    return c;
+}
+
+void Table::mulRatioColumn(std::size_t dst, std::size_t src,
+                           std::int64_t num, std::int64_t den) {
+    Column& d = checkedColumn(dst, Tag::MoneyVal, "Percent-of");
+    Column& s = checkedColumn(src, Tag::MoneyVal, "Percent-of");
+    batchMulRatio(d.money.data(), s.money.data(), rowCount_, num, den);
+    notifyBulk(dst);
+}
+
+void Table::addColumns(std::size_t dst, std::size_t a, std::size_t b) {
+    if (dst >= columns_.size() || a >= columns_.size() || b >= columns_.size())
+        throw MblError("Table column out of range");
+    Tag t = columns_[a].type;
+    if (columns_[b].type != t || columns_[dst].type != t)
+        throw MblError("Column addition needs three columns of one type");
+    switch (t) {
+        case Tag::MoneyVal:
+            batchAdd(columns_[dst].money.data(), columns_[a].money.data(),
+                     columns_[b].money.data(), rowCount_);
+            break;
+        case Tag::Integer: {
+            std::int64_t* out = columns_[dst].ints.data();
+            const std::int64_t* x = columns_[a].ints.data();
+            const std::int64_t* y = columns_[b].ints.data();
+            for (std::size_t i = 0; i < rowCount_; ++i) out[i] = x[i] + y[i];
+            break;
+        }
+        case Tag::Float: {
+            double* out = columns_[dst].floats.data();
+            const double* x = columns_[a].floats.data();
+            const double* y = columns_[b].floats.data();
+            for (std::size_t i = 0; i < rowCount_; ++i) out[i] = x[i] + y[i];
+            break;
+        }
+        default:
+            throw MblError("Column addition is numeric only");
+    }
+    notifyBulk(dst);
+}
+
+Value Table::sumColumn(std::size_t col) const {
+    if (col >= columns_.size()) throw MblError("Table column out of range");
+    const Column& c = columns_[col];
+    switch (c.type) {
+        case Tag::MoneyVal:
+            return Value::ofMoney(batchSum(c.money.data(), rowCount_));
+        case Tag::Integer: {
+            std::int64_t total = 0;
+            for (std::int64_t v : c.ints) total += v;
+            return Value::ofInt(total);
+        }
+        case Tag::Float: {
+            double total = 0.0;
+            for (double v : c.floats) total += v;
+            return Value::ofFloat(total);
+        }
+        default:
+            throw MblError("Cannot sum a Date column");
+    }
+}
+
+void Table::observe(std::size_t col, TableObserver* observer) {
+    if (col >= columns_.size()) throw MblError("Table column out of range");
+    observers_.emplace_back(col, observer);
+}
+
+void Table::notifyUpdate(std::size_t row, std::size_t col, Value oldValue, Value newValue) {
+    for (auto& observer : observers_) {
+        if (observer.first == col) observer.second->onUpdate(row, oldValue, newValue);
+    }
+}
+
+void Table::notifyBulk(std::size_t col) {
+    for (auto& observer : observers_) {
+        if (observer.first == col) observer.second->onBulkWrite();
+    }
+}
+
+} // namespace mbl
@@ -0,0 +1,118 @@
+#ifndef MBL_TABLE_H
+#define MBL_TABLE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "symbol.h"
+#include "value.h"
+
+namespace mbl {
+
+// Receives per-row change notifications from a Table; implemented by
+// derived-field recomputation (derived.h) and hash indexes (index.h).
+class TableObserver {
+public:
+    virtual ~TableObserver() = default;
+    virtual void onAppend(std::size_t row, Value v) = 0;
+    virtual void onUpdate(std::size_t row, Value oldValue, Value newValue) = 0;
+    // A whole-column kernel rewrote the column; no per-cell deltas exist.
+    virtual void onBulkWrite() = 0;
+};
+
+// MBL's Table type: the bulk counterpart to Object.  An Object is one
+// business record; a Table is forty million of them, stored column-major
+// with each column a typed contiguous array.  "Apply this formula to one
+// field of every record" then walks one flat array instead of chasing a
+// pointer per row, and the Money columns feed straight into the batch
+// kernels in money.h -- `interest% Of amount` over a whole column is one
+// batchMulRatio call.
+//
+// Columns are typed at declaration (Money, Integer, Float, Date) and a
+// write of the wrong type throws MblError rather than widening the column;
+// a Table is where the data is regular, and Object remains the home of
+// anything shapeless.
+
+class Table {
+public:
+    Table() = default;
+    Table(const Table&) = delete;
+    Table& operator=(const Table&) = delete;
+
+    // Declares a column; throws MblError for a duplicate name or a type
+    // that has no columnar representation.  Columns must be declared
+    // before the first row is appended.
+    std::size_t addColumn(const std::string& name, Tag type);
+
+    std::size_t columnCount() const { return columns_.size(); }
+    std::size_t rowCount() const { return rowCount_; }
+
+    // Returns the column index, or throws MblError for an unknown name.
+    std::size_t columnIndex(Symbol name) const;
+    Tag columnType(std::size_t col) const { return columns_[col].type; }
+
+    void reserve(std::size_t rows);
+
+    // Appends one row; values[0..columnCount) must match the declared
+    // column types exactly (Missing is not storable in a typed column).
+    void appendRow(const Value* values);
+
+    Value at(std::size_t row, std::size_t col) const;
+    void set(std::size_t row, std::size_t col, Value v);
+
+    // Direct typed access for the kernels and for bulk loaders; the caller
+    // is responsible for having checked the column type.
+    Money* moneyData(std::size_t col) { return columns_[col].money.data(); }
+    const Money* moneyData(std::size_t col) const { return columns_[col].money.data(); }
+    std::int64_t* intData(std::size_t col) { return columns_[col].ints.data(); }
+    const std::int64_t* intData(std::size_t col) const { return columns_[col].ints.data(); }
+    double* floatData(std::size_t col) { return columns_[col].floats.data(); }
+    const double* floatData(std::size_t col) const { return columns_[col].floats.data(); }
+    DateTime* dateData(std::size_t col) { return columns_[col].dates.data(); }
+    const DateTime* dateData(std::size_t col) const { return columns_[col].dates.data(); }
+
+    // Whole-column kernels.  Each checks column types once and then runs a
+    // single pass over contiguous storage.
+
+    // dst[i] = src[i] * num / den on a Money column -- the columnar form
+    // of `rate% Of amount` (num = rate, den = 100).
+    void mulRatioColumn(std::size_t dst, std::size_t src,
+                        std::int64_t num, std::int64_t den);
+
+    // dst[i] = a[i] + b[i]; columns must share one numeric type.
+    void addColumns(std::size_t dst, std::size_t a, std::size_t b);
+
+    // Exact column total: Money for Money columns, Integer/Float otherwise.
+    Value sumColumn(std::size_t col) const;
+
+    // Registers an observer over `col`.  appendRow and set report deltas;
+    // the whole-column kernels report one bulk write on their destination
+    // column instead.
+    void observe(std::size_t col, TableObserver* observer);
+
+private:
+    struct Column {
+        Symbol name;
+        Tag type;
+        // Only the vector matching `type` is ever populated; the empties
+        // cost three pointers each, which a Table has few enough columns
+        // to ignore.
+        std::vector<Money> money;
+        std::vector<std::int64_t> ints;
+        std::vector<double> floats;
+        std::vector<DateTime> dates;
+    };
+
+    Column& checkedColumn(std::size_t col, Tag expected, const char* what);
+    void notifyUpdate(std::size_t row, std::size_t col, Value oldValue, Value newValue);
+    void notifyBulk(std::size_t col);
+
+    std::vector<Column> columns_;
+    std::vector<std::pair<std::size_t, TableObserver*>> observers_;
+    std::size_t rowCount_ = 0;
+};
+
+} // namespace mbl
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef MBL_VALUE_H
+#define MBL_VALUE_H
+
+#include <cstdint>
+#include <string>
+
+#include "datetime.h"
+#include "money.h"
+
+namespace mbl {
+
+struct Object;
+class List;
+
+// A dynamically typed MBL value.  Small enough to pass and copy by value:
+// numbers, Money and dates live inline, anything bigger is a pointer into
+// the heap.  The VM's registers and the constant pools are arrays of these.
+enum class Tag : std::uint8_t {
+    Missing,   // MBL's Missing -- absent / unknown, distinct from zero
+    Boolean,
+    Integer,   // 64-bit signed
+    Float,     // IEEE double, for the few places exactness is not required
+    MoneyVal,  // exact fixed-point, see money.h
+    Date,      // packed civil date/time, see datetime.h
+    IntervalVal, // packed calendar span, see datetime.h
+    Text,      // pointer to an owned std::string (ownership rules in vm.cpp)
+    Obj,       // pointer to an MBL object
+    ListVal,   // pointer to a chunked list, see list.h
+};
+
+struct Value {
+    Tag tag;
+    union {
+        bool boolean;
+        std::int64_t integer;
+        double real;
+        Money money;
+        DateTime date;
+        std::uint64_t interval;  // Interval::pack() form
+        std::string* text;
+        Object* object;
+        List* list;
+    };
+
+    Value() : tag(Tag::Missing), integer(0) {}
+
+    static Value missing() { return Value(); }
+    static Value ofBool(bool b) { Value v; v.tag = Tag::Boolean; v.boolean = b; return v; }
+    static Value ofInt(std::int64_t i) { Value v; v.tag = Tag::Integer; v.integer = i; return v; }
+    static Value ofFloat(double d) { Value v; v.tag = Tag::Float; v.real = d; return v; }
+    static Value ofMoney(Money m) { Value v; v.tag = Tag::MoneyVal; v.money = m; return v; }
+    static Value ofDate(DateTime d) { Value v; v.tag = Tag::Date; v.date = d; return v; }
+    static Value ofInterval(Interval iv) {
+        Value v; v.tag = Tag::IntervalVal; v.interval = iv.pack(); return v;
+    }
+    static Value ofText(std::string* s) { Value v; v.tag = Tag::Text; v.text = s; return v; }
+    static Value ofObject(Object* o) { Value v; v.tag = Tag::Obj; v.object = o; return v; }
+    static Value ofList(List* l) { Value v; v.tag = Tag::ListVal; v.list = l; return v; }
+
+    bool isMissing() const { return tag == Tag::Missing; }
+
+    // MBL truthiness: Missing and false are false, zero values are false,
+    // everything else is true.
+    bool truthy() const {
+        switch (tag) {
+            case Tag::Missing: return false;
+            case Tag::Boolean: return boolean;
+            case Tag::Integer: return integer != 0;
+            case Tag::Float: return real != 0.0;
+            case Tag::MoneyVal: return money.units != 0;
+            case Tag::Date: return true;
+            case Tag::IntervalVal: return interval != 0;
+            case Tag::Text: return text && !text->empty();
+            case Tag::Obj: return object != nullptr;
+            case Tag::ListVal: return list != nullptr;
+        }
+        return false;
+    }
+};
+
+} // namespace mbl
+
+#endif
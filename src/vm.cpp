@@ -0,0 +1,433 @@
+#include "vm.h"
+
+#include "error.h"
+#include "gc.h"
+#include "jit.h"
+#include "list.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <optional>
+
+namespace mbl {
+
+namespace {
+
+[[noreturn]] void typeError(const char* op) {
+    throw MblError(std::string("Cannot apply ") + op + " to these value types");
+}
+
+// Binary arithmetic over the numeric tags.  Money mixes with integers where
+// the result stays exact (Money * int, Money / int); Money and Float never
+// mix implicitly -- silently converting ledger values to binary floating
+// point is exactly the class of bug MBL exists to prevent.
+Value arithAdd(Value a, Value b) {
+    if (a.tag == Tag::Integer && b.tag == Tag::Integer) return Value::ofInt(a.integer + b.integer);
+    if (a.tag == Tag::MoneyVal && b.tag == Tag::MoneyVal) return Value::ofMoney(a.money + b.money);
+    if (a.tag == Tag::Float && b.tag == Tag::Float) return Value::ofFloat(a.real + b.real);
+    if (a.tag == Tag::Integer && b.tag == Tag::Float) return Value::ofFloat(a.integer + b.real);
+    if (a.tag == Tag::Float && b.tag == Tag::Integer) return Value::ofFloat(a.real + b.integer);
+    if (a.tag == Tag::Date && b.tag == Tag::IntervalVal)
+        return Value::ofDate(addInterval(a.date, Interval::unpack(b.interval)));
+    if (a.tag == Tag::IntervalVal && b.tag == Tag::Date)
+        return Value::ofDate(addInterval(b.date, Interval::unpack(a.interval)));
+    if (a.tag == Tag::IntervalVal && b.tag == Tag::IntervalVal)
+        return Value::ofInterval(Interval::unpack(a.interval) + Interval::unpack(b.interval));
+    typeError("+");
+}
+
+Value arithSub(Value a, Value b) {
+    if (a.tag == Tag::Integer && b.tag == Tag::Integer) return Value::ofInt(a.integer - b.integer);
+    if (a.tag == Tag::MoneyVal && b.tag == Tag::MoneyVal) return Value::ofMoney(a.money - b.money);
+    if (a.tag == Tag::Float && b.tag == Tag::Float) return Value::ofFloat(a.real - b.real);
+    if (a.tag == Tag::Integer && b.tag == Tag::Float) return Value::ofFloat(a.integer - b.real);
+    if (a.tag == Tag::Float && b.tag == Tag::Integer) return Value::ofFloat(a.real - b.integer);
+    if (a.tag == Tag::Date && b.tag == Tag::IntervalVal)
+        return Value::ofDate(addInterval(a.date, -Interval::unpack(b.interval)));
+    if (a.tag == Tag::Date && b.tag == Tag::Date)
+        return Value::ofInterval(Interval{0, (std::int32_t)daysBetween(b.date, a.date), 0});
+    if (a.tag == Tag::IntervalVal && b.tag == Tag::IntervalVal)
+        return Value::ofInterval(Interval::unpack(a.interval) + -Interval::unpack(b.interval));
+    typeError("-");
+}
+
+Value arithMul(Value a, Value b) {
+    if (a.tag == Tag::Integer && b.tag == Tag::Integer) return Value::ofInt(a.integer * b.integer);
+    if (a.tag == Tag::Float && b.tag == Tag::Float) return Value::ofFloat(a.real * b.real);
+    if (a.tag == Tag::MoneyVal && b.tag == Tag::Integer) return Value::ofMoney(a.money.mulRatio(b.integer, 1));
+    if (a.tag == Tag::Integer && b.tag == Tag::MoneyVal) return Value::ofMoney(b.money.mulRatio(a.integer, 1));
+    if (a.tag == Tag::Integer && b.tag == Tag::Float) return Value::ofFloat(a.integer * b.real);
+    if (a.tag == Tag::Float && b.tag == Tag::Integer) return Value::ofFloat(a.real * b.integer);
+    typeError("*");
+}
+
+Value arithDiv(Value a, Value b) {
+    if (a.tag == Tag::MoneyVal && b.tag == Tag::Integer) {
+        return Value::ofMoney(a.money.mulRatio(1, b.integer));
+    }
+    if (a.tag == Tag::Integer && b.tag == Tag::Integer) {
+        if (b.integer == 0) throw MblError("Division by zero");
+        return Value::ofFloat((double)a.integer / (double)b.integer);
+    }
+    if (a.tag == Tag::Float && b.tag == Tag::Float) return Value::ofFloat(a.real / b.real);
+    if (a.tag == Tag::Float && b.tag == Tag::Integer) return Value::ofFloat(a.real / b.integer);
+    if (a.tag == Tag::Integer && b.tag == Tag::Float) return Value::ofFloat(a.integer / b.real);
+    typeError("/");
+}
+
+// The percent/Of operators: pct% Of v scales v by pct/100 in one step.
+// On Money this is a single mulRatio -- one half-to-even rounding --
+// where the naive Mul-then-Div lowering would round twice and box the
+// intermediate.  A fractional rate arrives as Money (decimal literals
+// are exact); its nine-digit scale folds into the denominator.
+Value percentOf(Value pct, Value v) {
+    if (pct.tag == Tag::Integer) {
+        if (v.tag == Tag::MoneyVal) return Value::ofMoney(v.money.mulRatio(pct.integer, 100));
+        if (v.tag == Tag::Integer) return Value::ofFloat((double)v.integer * (double)pct.integer / 100.0);
+        if (v.tag == Tag::Float) return Value::ofFloat(v.real * (double)pct.integer / 100.0);
+    }
+    if (pct.tag == Tag::MoneyVal) {
+        __int128 rate = pct.money.units;
+        if (rate > INT64_MAX || rate < INT64_MIN) typeError("percent Of");
+        if (v.tag == Tag::MoneyVal) {
+            return Value::ofMoney(v.money.mulRatio((std::int64_t)rate, 100 * Money::Scale));
+        }
+        double r = (double)(std::int64_t)rate / (100.0 * (double)Money::Scale);
+        if (v.tag == Tag::Integer) return Value::ofFloat((double)v.integer * r);
+        if (v.tag == Tag::Float) return Value::ofFloat(v.real * r);
+    }
+    typeError("percent Of");
+}
+
+Value mulRatio(Value v, Value num, Value den) {
+    if (num.tag != Tag::Integer || den.tag != Tag::Integer) typeError("ratio scaling");
+    if (den.integer == 0) throw MblError("Division by zero");
+    if (v.tag == Tag::MoneyVal) {
+        return Value::ofMoney(v.money.mulRatio(num.integer, den.integer));
+    }
+    if (v.tag == Tag::Integer) {
+        return Value::ofFloat((double)v.integer * (double)num.integer / (double)den.integer);
+    }
+    if (v.tag == Tag::Float) {
+        return Value::ofFloat(v.real * (double)num.integer / (double)den.integer);
+    }
+    typeError("ratio scaling");
+}
+
+bool compareEq(Value a, Value b) {
+    if (a.tag != b.tag) {
+        // Integer/Float compare by numeric value; anything else mismatched
+        // compares unequal (Missing only equals Missing).
+        if (a.tag == Tag::Integer && b.tag == Tag::Float) return (double)a.integer == b.real;
+        if (a.tag == Tag::Float && b.tag == Tag::Integer) return a.real == (double)b.integer;
+        return false;
+    }
+    switch (a.tag) {
+        case Tag::Missing: return true;
+        case Tag::Boolean: return a.boolean == b.boolean;
+        case Tag::Integer: return a.integer == b.integer;
+        case Tag::Float: return a.real == b.real;
+        case Tag::MoneyVal: return a.money == b.money;
+        case Tag::Date: return a.date == b.date;
+        case Tag::IntervalVal: return a.interval == b.interval;
+        case Tag::Text: return *a.text == *b.text;
+        case Tag::Obj: return a.object == b.object;
+        case Tag::ListVal: return a.list == b.list;
+    }
+    return false;
+}
+
+bool compareLt(Value a, Value b) {
+    if (a.tag == Tag::Integer && b.tag == Tag::Integer) return a.integer < b.integer;
+    if (a.tag == Tag::MoneyVal && b.tag == Tag::MoneyVal) return a.money < b.money;
+    if (a.tag == Tag::Date && b.tag == Tag::Date) return a.date < b.date;
+    if (a.tag == Tag::Float && b.tag == Tag::Float) return a.real < b.real;
+    if (a.tag == Tag::Integer && b.tag == Tag::Float) return (double)a.integer < b.real;
+    if (a.tag == Tag::Float && b.tag == Tag::Integer) return a.real < (double)b.integer;
+    if (a.tag == Tag::Text && b.tag == Tag::Text) return *a.text < *b.text;
+    typeError("<");
+}
+
+} // namespace
+
+Value VM::run(Chunk& chunk) {
+    if ((std::size_t)chunk.registerCount > registers_.size()) {
+        registers_.resize(chunk.registerCount);
+    }
+    if (chunk.hotCounts.size() != chunk.code.size()) {
+        chunk.hotCounts.assign(chunk.code.size(), 0);
+    }
+    ProfileScope profiled(chunk.profileSite);
+    // Frames never outlive a run: the chain is freed on every exit --
+    // Return, Halt, or a thrown MblError mid-scope -- so a later run on
+    // this VM cannot index stale frames through GetScoped.
+    struct ScopeUnwind {
+        VM* vm;
+        ~ScopeUnwind() {
+            Heap* heap = currentHeap();
+            while (Frame* frame = vm->env_) {
+                vm->env_ = frame->parent;
+                if (heap) heap->removeRootRange(frame->slots.data());
+                delete frame;
+            }
+        }
+    } unwind{this};
+    env_ = nullptr;
+    // Under a GcScope the register file is a root range (gc.h): a minor
+    // collection moves nursery objects, and values held only in registers
+    // must be found and forwarded.  Registered after the resize above --
+    // resizing moves the array -- and cleared first so stale values from a
+    // previous run are not scanned as live.
+    std::optional<GcRootRange> rootedRegisters;
+    if (Heap* heap = currentHeap()) {
+        std::fill_n(registers_.data(), chunk.registerCount, Value::missing());
+        rootedRegisters.emplace(*heap, registers_.data(),
+                                (std::size_t)chunk.registerCount);
+    }
+    Value* reg = registers_.data();
+    Instruction* pc = chunk.code.data();
+    const Value* constants = chunk.constants.data();
+
+// The two dispatch styles share handler bodies via these macros.  In
+// threaded mode NEXT is a computed goto through the opcode table; in the
+// portable build it falls out of the switch back to the loop top.
+#if defined(__GNUC__) || defined(__clang__)
+#define MBL_THREADED_DISPATCH 1
+#endif
+
+#ifdef MBL_THREADED_DISPATCH
+    static const void* dispatch[] = {
+        &&op_LoadConst, &&op_LoadMissing, &&op_Move,
+        &&op_Add, &&op_Sub, &&op_Mul, &&op_Div, &&op_Neg,
+        &&op_PercentOf, &&op_MulRatio,
+        &&op_Eq, &&op_Lt, &&op_Le, &&op_Not,
+        &&op_Jump, &&op_JumpIfFalse, &&op_JumpIfTrue,
+        &&op_NewObject, &&op_GetProp, &&op_SetProp, &&op_NewFrom,
+        &&op_NewList, &&op_Append, &&op_GetIndex, &&op_Length,
+        &&op_PushScope, &&op_PopScope, &&op_GetScoped, &&op_SetScoped,
+        &&op_Return, &&op_Halt,
+        &&op_AddInt, &&op_SubInt, &&op_MulInt,
+        &&op_AddMoney, &&op_SubMoney,
+        &&op_LtInt, &&op_LeInt,
+        &&op_LtMoney, &&op_LeMoney,
+        &&op_PercentOfMoney,
+    };
+#define CASE(name) op_##name:
+#define NEXT() do { i = *pc++; goto* dispatch[(std::uint8_t)opcode(i)]; } while (0)
+    Instruction i;
+    NEXT();
+#else
+#define CASE(name) case Op::name:
+#define NEXT() break
+    for (;;) {
+        Instruction i = *pc++;
+        switch (opcode(i)) {
+#endif
+
+    CASE(LoadConst) { reg[operandA(i)] = constants[operandBx(i)]; NEXT(); }
+    CASE(LoadMissing) { reg[operandA(i)] = Value::missing(); NEXT(); }
+    CASE(Move) { reg[operandA(i)] = reg[operandB(i)]; NEXT(); }
+
+    CASE(Add) { reg[operandA(i)] = arithAdd(reg[operandB(i)], reg[operandC(i)]); NEXT(); }
+    CASE(Sub) { reg[operandA(i)] = arithSub(reg[operandB(i)], reg[operandC(i)]); NEXT(); }
+    CASE(Mul) { reg[operandA(i)] = arithMul(reg[operandB(i)], reg[operandC(i)]); NEXT(); }
+    CASE(Div) { reg[operandA(i)] = arithDiv(reg[operandB(i)], reg[operandC(i)]); NEXT(); }
+    CASE(Neg) {
+        Value v = reg[operandB(i)];
+        if (v.tag == Tag::Integer) reg[operandA(i)] = Value::ofInt(-v.integer);
+        else if (v.tag == Tag::Float) reg[operandA(i)] = Value::ofFloat(-v.real);
+        else if (v.tag == Tag::MoneyVal) reg[operandA(i)] = Value::ofMoney(-v.money);
+        else typeError("negation");
+        NEXT();
+    }
+
+    CASE(PercentOf) { reg[operandA(i)] = percentOf(reg[operandB(i)], reg[operandC(i)]); NEXT(); }
+    CASE(MulRatio) {
+        reg[operandA(i)] = mulRatio(reg[operandB(i)], reg[operandC(i)],
+                                    reg[(std::uint8_t)(operandC(i) + 1)]);
+        NEXT();
+    }
+
+    CASE(Eq) { reg[operandA(i)] = Value::ofBool(compareEq(reg[operandB(i)], reg[operandC(i)])); NEXT(); }
+    CASE(Lt) { reg[operandA(i)] = Value::ofBool(compareLt(reg[operandB(i)], reg[operandC(i)])); NEXT(); }
+    CASE(Le) { reg[operandA(i)] = Value::ofBool(!compareLt(reg[operandC(i)], reg[operandB(i)])); NEXT(); }
+    CASE(Not) { reg[operandA(i)] = Value::ofBool(!reg[operandB(i)].truthy()); NEXT(); }
+
+    CASE(Jump) {
+        std::int16_t offset = operandSBx(i);
+        if (offset < 0) {
+            // Backward jump: count the loop, tier it up when hot.
+            std::size_t at = (std::size_t)(pc - chunk.code.data()) - 1;
+            if (at < chunk.loopSites.size() && chunk.loopSites[at] != kNoProfileSite) {
+                ProfileCounters& trips = profileSlot(chunk.loopSites[at]);
+                trips.loopTrips.store(
+                    trips.loopTrips.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+            }
+            if (++chunk.hotCounts[at] == kLoopHotThreshold) {
+                specializeLoop(chunk, reg, at + 1 + offset, at);
+            }
+        }
+        pc += offset;
+        NEXT();
+    }
+    CASE(JumpIfFalse) { if (!reg[operandA(i)].truthy()) pc += operandSBx(i); NEXT(); }
+    CASE(JumpIfTrue) { if (reg[operandA(i)].truthy()) pc += operandSBx(i); NEXT(); }
+
+    CASE(NewObject) {
+        Object* obj = Object::create();
+        Value protoVal = reg[operandB(i)];
+        if (protoVal.tag == Tag::Obj && protoVal.object) obj->setProto(protoVal.object);
+        reg[operandA(i)] = Value::ofObject(obj);
+        NEXT();
+    }
+    CASE(GetProp) {
+        Value base = reg[operandB(i)];
+        if (base.tag != Tag::Obj) typeError("property access");
+        reg[operandA(i)] = getPropCached(base.object, chunk.props[operandC(i)]);
+        NEXT();
+    }
+    CASE(SetProp) {
+        Value base = reg[operandA(i)];
+        if (base.tag != Tag::Obj) typeError("property assignment");
+        PropAccess& site = chunk.props[operandC(i)];
+        Value v = reg[operandB(i)];
+        // Guards are a flat array of predictable not-taken branches; most
+        // sites have none and skip on the empty() check.
+        for (const Guard& g : site.guards) {
+            if (!g.passes(v)) constraintFailure(g, v);
+        }
+        setPropCached(base.object, site, v);
+        NEXT();
+    }
+
+    CASE(NewFrom) {
+        Value sourceVal = reg[operandB(i)];
+        if (sourceVal.tag != Tag::Obj) typeError("new");
+        reg[operandA(i)] = Value::ofObject(cloneCow(sourceVal.object));
+        NEXT();
+    }
+    CASE(NewList) {
+        List* list = List::create();
+        Value hint = reg[operandB(i)];
+        if (hint.tag == Tag::Integer && hint.integer > 0) list->reserve((std::size_t)hint.integer);
+        reg[operandA(i)] = Value::ofList(list);
+        NEXT();
+    }
+    CASE(Append) {
+        Value target = reg[operandA(i)];
+        if (target.tag != Tag::ListVal) typeError("Append To");
+        target.list->append(reg[operandB(i)]);
+        NEXT();
+    }
+    CASE(GetIndex) {
+        Value target = reg[operandB(i)];
+        Value index = reg[operandC(i)];
+        if (target.tag != Tag::ListVal || index.tag != Tag::Integer) typeError("indexing");
+        if (index.integer < 0 || (std::size_t)index.integer >= target.list->size())
+            throw MblError("List index out of range");
+        reg[operandA(i)] = target.list->at((std::size_t)index.integer);
+        NEXT();
+    }
+    CASE(Length) {
+        Value target = reg[operandB(i)];
+        if (target.tag != Tag::ListVal) typeError("Length");
+        reg[operandA(i)] = Value::ofInt((std::int64_t)target.list->size());
+        NEXT();
+    }
+
+    CASE(PushScope) {
+        Frame* frame = new Frame();
+        frame->parent = env_;
+        frame->slots.resize(operandBx(i));
+        // Scoped slots are GC roots just like the register file.  The
+        // vector never reallocates after this resize (the resolver fixed
+        // the slot count at compile time), so the range stays valid for
+        // the frame's whole life.
+        if (Heap* heap = currentHeap()) {
+            heap->addRootRange(frame->slots.data(), frame->slots.size());
+        }
+        env_ = frame;
+        NEXT();
+    }
+    CASE(PopScope) {
+        Frame* frame = env_;
+        env_ = frame->parent;
+        if (Heap* heap = currentHeap()) heap->removeRootRange(frame->slots.data());
+        delete frame;
+        NEXT();
+    }
+    CASE(GetScoped) {
+        Frame* frame = env_;
+        for (std::uint8_t depth = operandB(i); depth; --depth) frame = frame->parent;
+        reg[operandA(i)] = frame->slots[operandC(i)];
+        NEXT();
+    }
+    CASE(SetScoped) {
+        Frame* frame = env_;
+        for (std::uint8_t depth = operandB(i); depth; --depth) frame = frame->parent;
+        frame->slots[operandC(i)] = reg[operandA(i)];
+        NEXT();
+    }
+
+    CASE(Return) { return reg[operandA(i)]; }
+    CASE(Halt) { return Value::missing(); }
+
+// Tier-2 handlers (see jit.h): a tag guard, the unboxed operation, and a
+// per-site deopt that restores the generic opcode and finishes through the
+// generic path when the guard fails.
+#define MBL_SPECIALIZED(name, tagWanted, fastExpr, genericOp, genericFn)                   \
+    CASE(name) {                                                                           \
+        Value b = reg[operandB(i)], c = reg[operandC(i)];                                  \
+        if (b.tag == tagWanted && c.tag == tagWanted) {                                    \
+            reg[operandA(i)] = fastExpr;                                                   \
+            NEXT();                                                                        \
+        }                                                                                  \
+        pc[-1] = encodeABC(genericOp, operandA(i), operandB(i), operandC(i));              \
+        reg[operandA(i)] = genericFn;                                                      \
+        NEXT();                                                                            \
+    }
+
+    MBL_SPECIALIZED(AddInt, Tag::Integer, Value::ofInt(b.integer + c.integer),
+                    Op::Add, arithAdd(b, c))
+    MBL_SPECIALIZED(SubInt, Tag::Integer, Value::ofInt(b.integer - c.integer),
+                    Op::Sub, arithSub(b, c))
+    MBL_SPECIALIZED(MulInt, Tag::Integer, Value::ofInt(b.integer * c.integer),
+                    Op::Mul, arithMul(b, c))
+    MBL_SPECIALIZED(AddMoney, Tag::MoneyVal, Value::ofMoney(b.money + c.money),
+                    Op::Add, arithAdd(b, c))
+    MBL_SPECIALIZED(SubMoney, Tag::MoneyVal, Value::ofMoney(b.money - c.money),
+                    Op::Sub, arithSub(b, c))
+    MBL_SPECIALIZED(LtInt, Tag::Integer, Value::ofBool(b.integer < c.integer),
+                    Op::Lt, Value::ofBool(compareLt(b, c)))
+    MBL_SPECIALIZED(LeInt, Tag::Integer, Value::ofBool(b.integer <= c.integer),
+                    Op::Le, Value::ofBool(!compareLt(c, b)))
+    MBL_SPECIALIZED(LtMoney, Tag::MoneyVal, Value::ofBool(b.money < c.money),
+                    Op::Lt, Value::ofBool(compareLt(b, c)))
+    MBL_SPECIALIZED(LeMoney, Tag::MoneyVal, Value::ofBool(b.money <= c.money),
+                    Op::Le, Value::ofBool(!compareLt(c, b)))
+#undef MBL_SPECIALIZED
+
+    // Hand-written because its guard is asymmetric: integer rate on one
+    // side, Money value on the other.
+    CASE(PercentOfMoney) {
+        Value b = reg[operandB(i)], c = reg[operandC(i)];
+        if (b.tag == Tag::Integer && c.tag == Tag::MoneyVal) {
+            reg[operandA(i)] = Value::ofMoney(c.money.mulRatio(b.integer, 100));
+            NEXT();
+        }
+        pc[-1] = encodeABC(Op::PercentOf, operandA(i), operandB(i), operandC(i));
+        reg[operandA(i)] = percentOf(b, c);
+        NEXT();
+    }
+
+#ifndef MBL_THREADED_DISPATCH
+        }
+    }
+#endif
+#undef CASE
+#undef NEXT
+#undef MBL_THREADED_DISPATCH
+}
+
+} // namespace mbl
@@ -0,0 +1,43 @@
+#ifndef MBL_VM_H
+#define MBL_VM_H
+
+#include <vector>
+
+#include "bytecode.h"
+#include "value.h"
+
+namespace mbl {
+
+// The execution core.  One VM per thread of MBL execution; registers are a
+// flat vector reused across runs so a hot Tool invoked in a loop does not
+// allocate.
+//
+// Dispatch is threaded (computed goto) on GCC and Clang: each handler jumps
+// straight to the next handler's address, which keeps the branch predictor
+// trained per-opcode-pair instead of funnelling every instruction through
+// one mispredicted switch.  Elsewhere it degrades to a plain switch loop
+// with identical semantics.
+// One lexical frame at runtime: the slots the resolver numbered at
+// compile time (resolve.h), chained to the enclosing scope.  GetScoped
+// walks `parent` depth times and indexes `slots` -- two array steps, no
+// name involved.
+struct Frame {
+    Frame* parent = nullptr;
+    std::vector<Value> slots;
+};
+
+class VM {
+public:
+    // Runs a chunk and returns its result (the Return register, or Missing
+    // if execution fell off the end through Halt).  The chunk is mutable
+    // because running it warms its inline caches.
+    Value run(Chunk& chunk);
+
+private:
+    std::vector<Value> registers_;
+    Frame* env_ = nullptr;  // innermost open frame
+};
+
+} // namespace mbl
+
+#endif